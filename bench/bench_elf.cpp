@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/elf_dependencies.h"
+#include "../include/elf_image.h"
+#include "../include/elf_loader.h"
+#include "../include/elf_scanner.h"
+#include "../include/fast_io.h"
+#include "../include/symbol_index.h"
+#include "bench_list.h"
+#include "bench_util.h"
+
+namespace {
+  // The reader ElfImage replaced: the whole file goes through a std::vector on every call
+  uint64_t load_size_from_whole_file(char const* path, uint64_t& entry) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    std::streamsize const size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    std::vector<char> buffer(size);
+    if (!file.read(buffer.data(), size)) {
+      return 0;
+    }
+    auto const header = reinterpret_cast<elf_hdr const*>(buffer.data());
+    entry = header->e_entry;
+    uint64_t res = 0;
+    for (int i = 0; i < header->e_phnum; ++i) {
+      auto const phdr = reinterpret_cast<elf_phdr const*>(buffer.data() + header->e_phoff + i * header->e_phentsize);
+      if (phdr->p_type == PT_LOAD) {
+        res += phdr->p_memsz;
+      }
+    }
+    return res;
+  }
+
+  // Copies 'src' and appends 'padding' bytes, like a binary with big debug sections
+  bool write_padded_copy(char const* src, std::string const& dst, uint64_t padding) {
+    std::ifstream in(src, std::ios::binary);
+    std::ofstream out(dst, std::ios::binary | std::ios::trunc);
+    if (!in || !out) {
+      return false;
+    }
+    out << in.rdbuf();
+    std::vector<char> const zeros(1 << 20, 0);
+    for (uint64_t left = padding; left > 0;) {
+      size_t const chunk = static_cast<size_t>(std::min<uint64_t>(left, zeros.size()));
+      out.write(zeros.data(), chunk);
+      left -= chunk;
+    }
+    return static_cast<bool>(out);
+  }
+}
+
+void benchElfImage(BenchArgs const& args) {
+  std::string const source = args.get_string("file", "/proc/self/exe");
+  uint64_t const padding = args.get_u64("padding-mb", 256) << 20;
+  uint64_t const repeat = args.get_u64("repeat", 5);
+  std::string const path = "bench_elf_padded.bin";
+  if (!write_padded_copy(source.c_str(), path, padding)) {
+    printf("can't copy %s\n", source.c_str());
+    return;
+  }
+
+  ElfImage image;
+  if (!image.open(path.c_str())) {
+    printf("%s: %s\n", path.c_str(), image.error());
+    std::remove(path.c_str());
+    return;
+  }
+  printf("%s + %llu MB padding: %zu bytes, %zu segments, entry 0x%llx, load size %llu\n", source.c_str(),
+         (unsigned long long) (padding >> 20), image.size(), image.segment_count(),
+         (unsigned long long) image.entry_point(), (unsigned long long) image.load_size());
+  image.close();
+
+  uint64_t entry = 0, size = 0;
+  Stopwatch sw;
+  for (uint64_t r = 0; r < repeat; ++r) {
+    size += load_size_from_whole_file(path.c_str(), entry);
+  }
+  double const whole_time = sw.seconds() / repeat;
+  do_not_optimize(size);
+
+  sw.restart();
+  for (uint64_t r = 0; r < repeat; ++r) {
+    size += space(path.c_str()) + entry_point(path.c_str());
+  }
+  double const image_time = sw.seconds() / repeat;
+  do_not_optimize(size);
+  printf("whole-file read: %.3f ms/call, ElfImage (entry_point + space): %.3f ms/call, %.0fx\n",
+         whole_time * 1e3, image_time * 1e3, whole_time / image_time);
+
+  // Truncated copies must be rejected instead of read past the end
+  char const* const names[] = { "header", "program headers" };
+  size_t const cuts[] = { sizeof(elf_hdr) / 2, sizeof(elf_hdr) + 8 };
+  std::vector<char> head(cuts[1]);
+  std::ifstream(path, std::ios::binary).read(head.data(), head.size());
+  for (size_t i = 0; i < 2; ++i) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(head.data(), cuts[i]);
+    bool const opened = image.open(path.c_str());
+    printf("cut in the %s (%zu bytes): %s\n", names[i], cuts[i], opened ? "OPENED" : image.error());
+  }
+  std::remove(path.c_str());
+}
+
+namespace {
+  void bench_symbols_of(char const* path, BenchArgs const& args) {
+    ElfImage image;
+    if (!image.open(path)) {
+      printf("%s: %s\n", path, image.error());
+      return;
+    }
+    SymbolIndex index;
+    Stopwatch sw;
+    if (!index.build(image)) {
+      printf("%s: %s\n", path, index.error());
+      return;
+    }
+    double const build_time = sw.seconds();
+    std::vector<Symbol> const& symbols = index.symbols();
+    printf("--- %s: %zu symbols, %zu address ranges, .gnu.hash %s, index built in %.2f ms\n", path, symbols.size(),
+           index.address_ranges(), index.uses_gnu_hash() ? "reused" : "not used", build_time * 1e3);
+    if (symbols.empty() || !index.address_ranges()) {
+      return;
+    }
+
+    // Every name must resolve to a symbol with that name
+    size_t bad_names = 0;
+    sw.restart();
+    for (auto const& symbol : symbols) {
+      Symbol const* found = index.find(symbol.name);
+      bad_names += !found || std::strcmp(found->name, symbol.name) != 0;
+    }
+    double const find_time = sw.seconds();
+    size_t const sample = std::min<size_t>(symbols.size(), 2000);
+    sw.restart();
+    for (size_t i = 0; i < sample; ++i) {
+      auto const it = std::find_if(symbols.begin(), symbols.end(), [&](Symbol const& s) {
+        return std::strcmp(s.name, symbols[i].name) == 0;
+      });
+      do_not_optimize(it);
+    }
+    double const scan_time = sw.seconds();
+    printf("name lookup: %.1f ns (linear scan %.1f ns), %zu names not found\n", find_time * 1e9 / symbols.size(),
+           scan_time * 1e9 / sample, bad_names);
+
+    // Sampled PCs over the range of the functions and objects
+    uint64_t lo = ~0ULL, hi = 0;
+    for (auto const& symbol : symbols) {
+      if ((symbol.type == STT_FUNC || symbol.type == STT_OBJECT) && symbol.address) {
+        lo = std::min(lo, symbol.address);
+        hi = std::max(hi, symbol.address + symbol.size);
+      }
+    }
+    size_t const pc_count = args.get_u64("pcs", 4000000);
+    std::vector<uint64_t> pcs(pc_count);
+    std::mt19937_64 rng(args.get_u64("seed", 1));
+    for (auto& pc : pcs) {
+      pc = lo + rng() % (hi - lo + 1);
+    }
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < std::min<size_t>(pc_count, 1000); ++i) {
+      Symbol const* best = nullptr;
+      for (auto const& symbol : symbols) {
+        if ((symbol.type == STT_FUNC || symbol.type == STT_OBJECT) && symbol.size && symbol.address <= pcs[i] &&
+            pcs[i] < symbol.address + symbol.size && (!best || symbol.address > best->address)) {
+          best = &symbol;
+        }
+      }
+      Symbol const* found = index.symbolize(pcs[i]);
+      // Sized symbols must agree, the index may also attribute gaps to size 0 symbols
+      mismatches += best ? (!found || found->address != best->address) : (found && found->size);
+    }
+
+    size_t const max_threads = args.get_u64("max-threads", std::max(1u, std::thread::hardware_concurrency()));
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+      std::vector<size_t> hits(threads);
+      sw.restart();
+      std::vector<std::thread> workers;
+      for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+          size_t found = 0;
+          for (size_t i = t; i < pc_count; i += threads) {
+            found += index.symbolize(pcs[i]) != nullptr;
+          }
+          hits[t] = found;
+        });
+      }
+      for (auto& worker : workers) {
+        worker.join();
+      }
+      double const time = sw.seconds();
+      size_t total = 0;
+      for (size_t found : hits) {
+        total += found;
+      }
+      printf("symbolize %zu PCs on %zu threads: %.1f ns/PC, %.1f M PCs/s, %.1f%% resolved\n", pc_count, threads,
+             time * 1e9 / pc_count, pc_count / time / 1e6, 100.0 * total / pc_count);
+    }
+    printf("address lookups checked against a linear scan: %zu mismatches\n", mismatches);
+  }
+}
+
+void benchSymbolIndex(BenchArgs const& args) {
+  bench_symbols_of(args.get_string("file", "/proc/self/exe").c_str(), args);
+  std::string const lib = args.get_string("lib", "/lib/x86_64-linux-gnu/libc.so.6");
+  if (!lib.empty()) {
+    bench_symbols_of(lib.c_str(), args);
+  }
+}
+
+void benchElfScanner(BenchArgs const& args) {
+  std::string const dir = args.get_string("dir", "/usr");
+  ElfScanFormat const format = args.get_string("format", "csv") == "json" ? ElfScanFormat::JSON : ElfScanFormat::CSV;
+  std::string const out_path = args.get_string("out", "");
+  size_t const max_workers = args.get_u64("max-workers", std::max(1u, std::thread::hardware_concurrency()));
+
+  // The first pass warms the page cache, so every row measures the same mostly cached tree
+  for (size_t workers = 1, pass = 0; workers <= max_workers; workers *= pass++ ? 2 : 1) {
+    BufferedWriter out;
+    bool const write = !out_path.empty() && workers == max_workers && pass;
+    if (write && !out.open(out_path.c_str())) {
+      printf("can't create %s\n", out_path.c_str());
+      return;
+    }
+    std::string line = elf_scan_header(format);
+    uint64_t output_bytes = 0;
+    if (write) {
+      out.write(line.data(), line.size());
+    }
+
+    ElfScanOptions options;
+    options.workers = workers;
+    ElfScanStats const stats = scan_elf_tree(dir.c_str(), [&](ElfScanResult const& result) {
+      line.clear();
+      format_elf_scan_result(result, format, line);
+      output_bytes += line.size();
+      if (write) {
+        out.write(line.data(), line.size());
+      }
+    }, options);
+    if (write) {
+      out.close();
+    }
+
+    printf("%s %2zu workers: %llu files, %llu ELF, %llu errors, %.2f MB read, %.2f MB of %s, %.2f s, %.0f files/s\n",
+           pass ? "      " : "(cold)", workers, (unsigned long long) stats.files, (unsigned long long) stats.elf_files,
+           (unsigned long long) stats.errors, stats.bytes_read / 1e6, output_bytes / 1e6,
+           format == ElfScanFormat::CSV ? "CSV" : "JSON", stats.seconds, stats.files / stats.seconds);
+  }
+}
+
+void benchElfLoader(BenchArgs const& args) {
+  std::vector<std::string> files;
+  files.push_back(args.get_string("file", "/proc/self/exe"));
+  std::string const lib = args.get_string("lib", "/lib/x86_64-linux-gnu/libc.so.6");
+  if (!lib.empty()) {
+    files.push_back(lib);
+  }
+  bool const map = args.get_u64("map", 1) != 0;
+  uint64_t const repeat = args.get_u64("repeat", 1000);
+
+  for (auto const& file : files) {
+    ElfImage image;
+    if (!image.open(file.c_str())) {
+      printf("%s: %s\n", file.c_str(), image.error());
+      continue;
+    }
+    Stopwatch sw;
+    LoadFootprint fp;
+    for (uint64_t r = 0; r < repeat; ++r) {
+      fp = compute_load_footprint(image);
+    }
+    double const time = sw.seconds() / repeat;
+    uint64_t const page = fp.page_size;
+
+    printf("--- %s: %zu PT_LOAD segments, footprint computed in %.2f us\n", file.c_str(), fp.segments.size(),
+           time * 1e6);
+    for (auto const& segment : fp.segments) {
+      char perms[4];
+      segment_permissions(segment.phdr.p_flags, perms);
+      printf("  %s vaddr 0x%08llx memsz 0x%08llx align 0x%llx: pages [0x%llx, 0x%llx), %llu file, %llu BSS (%llu bytes)%s\n",
+             perms, (unsigned long long) segment.phdr.p_vaddr, (unsigned long long) segment.phdr.p_memsz,
+             (unsigned long long) segment.phdr.p_align, (unsigned long long) segment.page_start,
+             (unsigned long long) segment.page_end, (unsigned long long) segment.file_pages,
+             (unsigned long long) segment.bss_pages, (unsigned long long) segment.bss_bytes,
+             (segment.phdr.p_flags & PF_W) && (segment.phdr.p_flags & PF_X) ? ", WRITABLE AND EXECUTABLE" : "");
+    }
+    printf("space(): %llu bytes; span %llu pages (%llu KiB), mapped %llu pages (%llu file, %llu BSS), "
+           "%llu overlapping, %llu in gaps\n",
+           (unsigned long long) fp.naive_size, (unsigned long long) fp.span_pages,
+           (unsigned long long) (fp.span_pages * page / 1024), (unsigned long long) fp.mapped_pages,
+           (unsigned long long) fp.file_pages, (unsigned long long) fp.bss_pages,
+           (unsigned long long) fp.overlap_pages, (unsigned long long) fp.gap_pages);
+
+    if (!map) {
+      continue;
+    }
+    SegmentLoader loader;
+    uint64_t const rss_before = process_rss();
+    sw.restart();
+    if (!loader.load(file.c_str())) {
+      printf("loader: %s\n", loader.error());
+      continue;
+    }
+    double const load_time = sw.seconds();
+    uint64_t const rss_loaded = process_rss();
+    uint64_t const touched = loader.touch();
+    uint64_t const rss_touched = process_rss();
+    printf("mapped at %p in %.1f us: RSS +%llu KiB after mapping, +%llu KiB after touching %llu pages "
+           "(predicted %llu KiB)\n", static_cast<void const*>(loader.base()), load_time * 1e6,
+           (unsigned long long) ((rss_loaded - rss_before) / 1024),
+           (unsigned long long) ((rss_touched - rss_before) / 1024), (unsigned long long) touched,
+           (unsigned long long) (fp.mapped_pages * page / 1024));
+  }
+}
+
+void benchElfDependencies(BenchArgs const& args) {
+  std::string const file = args.get_string("file", "/proc/self/exe");
+  std::string const dir = args.get_string("dir", "/usr/bin");
+  size_t const max_files = args.get_u64("max-files", 1000);
+
+  LibraryCache cache;
+  DependencyGraph graph;
+  if (resolve_dependencies(file.c_str(), cache, graph)) {
+    printf("--- %s: %zu objects, %zu missing, %.1f KiB mapped\n", file.c_str(), graph.nodes.size(),
+           graph.missing.size(), graph.mapped_bytes / 1024.0);
+    for (size_t i = 1; i < graph.nodes.size(); ++i) {
+      printf("  %s => %s (%.1f KiB)\n", graph.nodes[i].info->soname.c_str(), graph.nodes[i].path.c_str(),
+             graph.nodes[i].info->mapped_bytes / 1024.0);
+    }
+    for (auto const& name : graph.missing) {
+      printf("  %s => not found\n", name.c_str());
+    }
+  }
+
+  // Binaries of a directory, resolved with a cache per binary and with one shared cache
+  std::vector<std::string> binaries;
+  scan_elf_tree(dir.c_str(), [&](ElfScanResult const& result) {
+    if (binaries.size() < max_files) {
+      binaries.push_back(result.path);
+    }
+  });
+  std::sort(binaries.begin(), binaries.end());
+  if (binaries.empty()) {
+    return;
+  }
+
+  for (int shared = 0; shared < 2; ++shared) {
+    LibraryCache shared_cache;
+    uint64_t parses = 0, hashes = 0, hits = 0, objects = 0, missing = 0, mapped = 0, resolved = 0;
+    Stopwatch sw;
+    for (auto const& binary : binaries) {
+      LibraryCache own_cache;
+      LibraryCache& used = shared ? shared_cache : own_cache;
+      if (resolve_dependencies(binary.c_str(), used, graph)) {
+        ++resolved;
+        objects += graph.nodes.size();
+        missing += graph.missing.size();
+        mapped += graph.mapped_bytes;
+      }
+      if (!shared) {
+        parses += own_cache.parses();
+        hashes += own_cache.hashes();
+        hits += own_cache.hits();
+      }
+    }
+    double const time = sw.seconds();
+    if (shared) {
+      parses = shared_cache.parses();
+      hashes = shared_cache.hashes();
+      hits = shared_cache.hits();
+    }
+    printf("%s cache: %zu binaries of %s in %.1f ms (%.0f binaries/s), %llu parses, %llu hashes, %llu hits, "
+           "%.1f objects and %.1f MiB mapped per binary, %llu missing\n",
+           shared ? "shared     " : "per binary ", binaries.size(), dir.c_str(), time * 1e3,
+           binaries.size() / time, (unsigned long long) parses,
+           (unsigned long long) hashes, (unsigned long long) hits,
+           static_cast<double>(objects) / std::max<uint64_t>(resolved, 1),
+           mapped / 1048576.0 / std::max<uint64_t>(resolved, 1), (unsigned long long) missing);
+  }
+}
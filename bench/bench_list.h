@@ -0,0 +1,28 @@
+#pragma once
+
+class BenchArgs;
+
+void benchPhysicalMemory(BenchArgs const& args);
+void benchTlb(BenchArgs const& args);
+void benchBatchTranslation(BenchArgs const& args);
+void benchTranslationPipeline(BenchArgs const& args);
+void benchMappingIo(BenchArgs const& args);
+void benchPagingModes(BenchArgs const& args);
+void benchPageTableSnapshot(BenchArgs const& args);
+void benchReverseMapping(BenchArgs const& args);
+void benchDemandPaging(BenchArgs const& args);
+void benchRoundRobin(BenchArgs const& args);
+void benchRoundRobinAdvance(BenchArgs const& args);
+void benchMlfq(BenchArgs const& args);
+void benchFair(BenchArgs const& args);
+void benchMultiCpu(BenchArgs const& args);
+void benchTraceReplay(BenchArgs const& args);
+void benchLocks(BenchArgs const& args);
+
+#ifndef _WINDOWS
+void benchElfImage(BenchArgs const& args);
+void benchSymbolIndex(BenchArgs const& args);
+void benchElfScanner(BenchArgs const& args);
+void benchElfLoader(BenchArgs const& args);
+void benchElfDependencies(BenchArgs const& args);
+#endif
@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "../include/threads/adaptive_mutex.h"
+#include "../include/threads/distributed_rw_lock.h"
+#include "../include/threads/queue_locks.h"
+#include "../include/threads/read_write_lock.h"
+#include "../include/threads/rwm_locks.h"
+#include "../include/threads/thread_synchronization.h"
+#include "bench_list.h"
+#include "bench_util.h"
+
+namespace {
+  // Every lock behind lock(me)/unlock(me), 'me' is the index of the calling thread.
+  // MAX_THREADS 0 means any number, EXCLUSIVE false means holders may share the critical section.
+  // The locks of src/threads with Layout and Order policies take them as template parameters.
+  struct StdMutexLock {
+    static constexpr int MAX_THREADS = 0;
+    static constexpr bool EXCLUSIVE = true;
+    std::mutex mutex;
+    void lock(int) { mutex.lock(); }
+    void unlock(int) { mutex.unlock(); }
+  };
+
+  template <typename Layout = PackedLayout, typename Order = SeqCstOrder>
+  struct RmwLock {
+    static constexpr int MAX_THREADS = 0;
+    static constexpr bool EXCLUSIVE = true;
+    RMWLock::BasicMutex<Layout, Order> mutex {};
+    void lock(int) { RMWLock::lock(&mutex); }
+    void unlock(int) { RMWLock::unlock(&mutex); }
+  };
+
+  struct AdaptiveMutexLock {
+    static constexpr int MAX_THREADS = 0;
+    static constexpr bool EXCLUSIVE = true;
+    AdaptiveMutex mutex;
+    void lock(int) { mutex.lock(); }
+    void unlock(int) { mutex.unlock(); }
+  };
+
+  template <typename Layout = PackedLayout, typename Order = SeqCstOrder>
+  struct TicketMutexLock {
+    static constexpr int MAX_THREADS = 0;
+    static constexpr bool EXCLUSIVE = true;
+    TicketLock::BasicMutex<Layout, Order> mutex {};
+    void lock(int) { TicketLock::lock(&mutex); }
+    void unlock(int) { TicketLock::unlock(&mutex); }
+  };
+
+  // The queue locks need a node per thread between lock and unlock
+  struct McsQueueLock {
+    static constexpr int MAX_THREADS = 256;
+    static constexpr bool EXCLUSIVE = true;
+    McsLock mutex;
+    McsLock::Node nodes[MAX_THREADS];
+    void lock(int me) { mutex.lock(nodes[me]); }
+    void unlock(int me) { mutex.unlock(nodes[me]); }
+  };
+
+  struct ClhQueueLock {
+    static constexpr int MAX_THREADS = 256;
+    static constexpr bool EXCLUSIVE = true;
+    ClhLock mutex;
+    ClhLock::Node* nodes[MAX_THREADS] = {};
+    void lock(int me) { nodes[me] = mutex.lock(); }
+    void unlock(int me) { mutex.unlock(nodes[me]); }
+  };
+
+  // Reader-writer locks behind read_lock(me)/read_unlock(me)/write_lock(me)/write_unlock(me),
+  // made into a lock of the benchmark by ReadSide, WriteSide or MixedSide
+  template <typename Layout = PackedLayout, typename Order = SeqCstOrder>
+  struct TicketRw {
+    static constexpr int MAX_THREADS = 0;
+    BasicRWLock<Layout, Order> rwlock {};
+    void read_lock(int) { ::read_lock(&rwlock); }
+    void read_unlock(int) { ::read_unlock(&rwlock); }
+    void write_lock(int) { ::write_lock(&rwlock); }
+    void write_unlock(int) { ::write_unlock(&rwlock); }
+  };
+
+  // std::shared_mutex is C++17, the timed one has the same reader-writer implementation in libstdc++
+  struct SharedMutexRw {
+    static constexpr int MAX_THREADS = 0;
+    std::shared_timed_mutex mutex;
+    void read_lock(int) { mutex.lock_shared(); }
+    void read_unlock(int) { mutex.unlock_shared(); }
+    void write_lock(int) { mutex.lock(); }
+    void write_unlock(int) { mutex.unlock(); }
+  };
+
+  struct DistributedRw {
+    static constexpr int MAX_THREADS = 256;
+    DistributedRWLock rwlock;
+    int tokens[MAX_THREADS] = {};
+    void read_lock(int me) { tokens[me] = rwlock.read_lock(); }
+    void read_unlock(int me) { rwlock.read_unlock(tokens[me]); }
+    void write_lock(int) { rwlock.write_lock(); }
+    void write_unlock(int) { rwlock.write_unlock(); }
+  };
+
+  template <typename Rw>
+  struct ReadSide {
+    static constexpr int MAX_THREADS = Rw::MAX_THREADS;
+    static constexpr bool EXCLUSIVE = false;
+    Rw rw;
+    void lock(int me) { rw.read_lock(me); }
+    void unlock(int me) { rw.read_unlock(me); }
+  };
+
+  template <typename Rw>
+  struct WriteSide {
+    static constexpr int MAX_THREADS = Rw::MAX_THREADS;
+    static constexpr bool EXCLUSIVE = true;
+    Rw rw;
+    void lock(int me) { rw.write_lock(me); }
+    void unlock(int me) { rw.write_unlock(me); }
+  };
+
+  // Every WRITE_EVERY-th acquisition of each thread writes, the others read
+  template <typename Rw>
+  struct MixedSide {
+    static constexpr int MAX_THREADS = 256;
+    static constexpr bool EXCLUSIVE = false;
+    static constexpr uint64_t WRITE_EVERY = 100;
+    struct alignas(64) State {
+      uint64_t acquisitions = 0;
+      bool writing = false;
+    };
+    Rw rw;
+    State states[MAX_THREADS];
+    void lock(int me) {
+      State& state = states[me];
+      state.writing = ++state.acquisitions % WRITE_EVERY == 0;
+      if (state.writing) {
+        rw.write_lock(me);
+      } else {
+        rw.read_lock(me);
+      }
+    }
+    void unlock(int me) {
+      if (states[me].writing) {
+        rw.write_unlock(me);
+      } else {
+        rw.read_unlock(me);
+      }
+    }
+  };
+
+  template <typename Layout, typename Order>
+  using RwWriteLock = WriteSide<TicketRw<Layout, Order>>;
+  template <typename Layout, typename Order>
+  using RwReadLock = ReadSide<TicketRw<Layout, Order>>;
+
+  template <typename Layout = PackedLayout, typename Order = SeqCstOrder>
+  struct Peterson2Lock {
+    static constexpr int MAX_THREADS = 2;
+    static constexpr bool EXCLUSIVE = true;
+    Peterson2Threads::BasicMutex<Layout, Order> mutex {};
+    void lock(int me) { Peterson2Threads::lock(&mutex, me); }
+    void unlock(int me) { Peterson2Threads::unlock(&mutex, me); }
+  };
+
+  struct PetersonGreedyLock {
+    static constexpr int MAX_THREADS = PetersonGreedy::N;
+    static constexpr bool EXCLUSIVE = true;
+    PetersonGreedy::Mutex mutex {};
+    void lock(int me) { PetersonGreedy::lock(&mutex, me); }
+    void unlock(int me) { PetersonGreedy::unlock(&mutex, me); }
+  };
+
+  template <typename Layout = PackedLayout, typename Order = SeqCstOrder>
+  struct OptimizedPetersonLock {
+    static constexpr int MAX_THREADS = OptimizedPeterson::N;
+    static constexpr bool EXCLUSIVE = true;
+    OptimizedPeterson::BasicMutex<Layout, Order> mutex {};
+    void lock(int me) { OptimizedPeterson::lock(&mutex, me); }
+    void unlock(int me) { OptimizedPeterson::unlock(&mutex, me); }
+  };
+
+  uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  uint64_t percentile(std::vector<uint64_t>& values, double fraction) {
+    if (values.empty()) {
+      return 0;
+    }
+    size_t const index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+  }
+
+  struct alignas(64) Worker {
+    uint64_t acquisitions = 0;
+    std::vector<uint64_t> latencies;  // ns, the last 'samples' acquisitions
+    uint64_t handoffs = 0;
+    std::vector<uint64_t> handoff_latencies;  // ns from the unlock of another thread to this acquisition
+  };
+
+  // What the critical section touches, on its own cache line
+  struct alignas(64) Shared {
+    uint64_t value = 0;
+    uint64_t entries = 0;
+    int owner = -1;         // the last holder
+    uint64_t released = 0;  // when it called unlock
+  };
+
+  struct LockRunConfig {
+    size_t threads = 1;
+    uint64_t critical_section = 0;  // iterations of the loop inside the lock
+    uint64_t think = 0;             // iterations of the loop between unlock and the next lock
+    uint64_t duration_ms = 200;
+    uint64_t samples = 0;           // latencies kept per thread, the latest ones
+    bool pin = true;
+  };
+
+  struct LockRunResult {
+    double seconds = 0;
+    double cpu_seconds = 0;  // of the whole process, above 'seconds' * cores means the waiters burn the CPU
+    uint64_t acquisitions = 0;
+    uint64_t p50_ns = 0, p99_ns = 0, p999_ns = 0, max_ns = 0;  // acquire latency
+    uint64_t handoff_p50_ns = 0, handoff_p99_ns = 0;            // unlock of one thread to lock of the next
+    uint64_t min_per_thread = 0, max_per_thread = 0;
+    double spread = 0;  // (max - min) / mean acquisitions per thread
+    double jain = 0;    // Jain's index of the acquisitions per thread, 1 is perfectly even
+    bool exclusive_ok = true;
+  };
+
+  void pin_thread(size_t index) {
+#ifdef __linux__
+    unsigned const cpus = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void) index;
+#endif
+  }
+
+  template <typename Lock>
+  LockRunResult run_lock(Lock& lock, LockRunConfig const& config) {
+    size_t const threads = config.threads;
+    std::vector<Worker> workers(threads);
+    Shared shared;
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false), stop(false);
+
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; ++t) {
+      pool.emplace_back([&, t]() {
+        if (config.pin) {
+          pin_thread(t);
+        }
+        Worker& worker = workers[t];
+        worker.latencies.assign(config.samples, 0);
+        worker.handoff_latencies.assign(Lock::EXCLUSIVE ? config.samples : 0, 0);
+        int const me = static_cast<int>(t);
+        uint64_t local = 0;
+        ready.fetch_add(1);
+        while (!go.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        while (!stop.load(std::memory_order_relaxed)) {
+          uint64_t const start = now_ns();
+          lock.lock(me);
+          uint64_t const acquired = now_ns();
+          if (Lock::EXCLUSIVE) {
+            if (shared.owner != me && shared.owner != -1 && config.samples) {
+              worker.handoff_latencies[worker.handoffs++ % config.samples] = acquired - shared.released;
+            }
+            ++shared.entries;
+            for (uint64_t i = 0; i < config.critical_section; ++i) {
+              ++shared.value;
+              do_not_optimize(shared.value);
+            }
+            shared.owner = me;
+            shared.released = now_ns();
+          } else {
+            for (uint64_t i = 0; i < config.critical_section; ++i) {
+              local += shared.value;
+              do_not_optimize(local);
+            }
+          }
+          lock.unlock(me);
+          for (uint64_t i = 0; i < config.think; ++i) {
+            ++local;
+            do_not_optimize(local);
+          }
+          if (config.samples) {
+            worker.latencies[worker.acquisitions % config.samples] = acquired - start;
+          }
+          ++worker.acquisitions;
+        }
+      });
+    }
+    while (ready.load() != threads) {
+      std::this_thread::yield();
+    }
+    Stopwatch sw;
+    std::clock_t const cpu_start = std::clock();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(config.duration_ms));
+    stop.store(true);
+    double const seconds = sw.seconds();
+    double const cpu_seconds = double(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    for (auto& thread : pool) {
+      thread.join();
+    }
+
+    LockRunResult res;
+    res.seconds = seconds;
+    res.cpu_seconds = cpu_seconds;
+    std::vector<uint64_t> latencies, handoffs;
+    uint64_t least = UINT64_MAX, most = 0;
+    double sum_squares = 0;
+    for (auto const& worker : workers) {
+      res.acquisitions += worker.acquisitions;
+      least = std::min(least, worker.acquisitions);
+      most = std::max(most, worker.acquisitions);
+      sum_squares += double(worker.acquisitions) * worker.acquisitions;
+      latencies.insert(latencies.end(), worker.latencies.begin(),
+                       worker.latencies.begin() + std::min<uint64_t>(worker.acquisitions, config.samples));
+      handoffs.insert(handoffs.end(), worker.handoff_latencies.begin(),
+                      worker.handoff_latencies.begin() + std::min<uint64_t>(worker.handoffs, config.samples));
+    }
+    res.min_per_thread = least;
+    res.max_per_thread = most;
+    double const mean = double(res.acquisitions) / threads;
+    res.spread = mean > 0 ? (most - least) / mean : 0;
+    res.jain = sum_squares > 0 ? double(res.acquisitions) * res.acquisitions / (threads * sum_squares) : 0;
+    res.p50_ns = percentile(latencies, 0.5);
+    res.p99_ns = percentile(latencies, 0.99);
+    res.p999_ns = percentile(latencies, 0.999);
+    res.handoff_p50_ns = percentile(handoffs, 0.5);
+    res.handoff_p99_ns = percentile(handoffs, 0.99);
+    res.max_ns = latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end());
+    res.exclusive_ok = !Lock::EXCLUSIVE ||
+        (shared.entries == res.acquisitions && shared.value == res.acquisitions * config.critical_section);
+    return res;
+  }
+
+  void print_lock_result(char const* name, LockRunConfig const& config, LockRunResult const& res) {
+    unsigned const cpus = std::max(1u, std::thread::hardware_concurrency());
+    printf("{\"lock\":\"%s\",\"threads\":%zu,\"cpus\":%u,\"oversubscribed\":%s,\"critical_section\":%llu,"
+           "\"think\":%llu,\"pinned\":%s,\"seconds\":%.3f,\"cpu_seconds\":%.3f,\"acquisitions\":%llu,\"throughput\":%.0f,"
+           "\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu,\"handoff_p50_ns\":%llu,\"handoff_p99_ns\":%llu,"
+           "\"min_per_thread\":%llu,\"max_per_thread\":%llu,\"spread\":%.4f,\"jain\":%.4f,\"mutual_exclusion\":%s}\n",
+           name, config.threads, cpus, config.threads > cpus ? "true" : "false",
+           static_cast<unsigned long long>(config.critical_section), static_cast<unsigned long long>(config.think),
+           config.pin ? "true" : "false", res.seconds, res.cpu_seconds,
+           static_cast<unsigned long long>(res.acquisitions), res.acquisitions / res.seconds,
+           static_cast<unsigned long long>(res.p50_ns), static_cast<unsigned long long>(res.p99_ns),
+           static_cast<unsigned long long>(res.p999_ns), static_cast<unsigned long long>(res.max_ns),
+           static_cast<unsigned long long>(res.handoff_p50_ns), static_cast<unsigned long long>(res.handoff_p99_ns),
+           static_cast<unsigned long long>(res.min_per_thread), static_cast<unsigned long long>(res.max_per_thread),
+           res.spread, res.jain, res.exclusive_ok ? "true" : "false");
+    fflush(stdout);
+  }
+
+  std::vector<size_t> lock_thread_counts(BenchArgs const& args) {
+    size_t const max_threads = args.get_u64("max-threads", std::max(2u, std::thread::hardware_concurrency()));
+    std::vector<size_t> res;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+      res.push_back(threads);
+    }
+    if (res.back() != max_threads) {
+      res.push_back(max_threads);
+    }
+    return res;
+  }
+
+  LockRunConfig lock_run_config(BenchArgs const& args) {
+    LockRunConfig config;
+    config.critical_section = args.get_u64("cs", 50);
+    config.think = args.get_u64("think", 100);
+    config.duration_ms = args.get_u64("duration-ms", 200);
+    config.samples = args.get_u64("samples", 1 << 18);
+    config.pin = args.get_u64("pin", 1) != 0;
+    return config;
+  }
+
+  bool lock_selected(BenchArgs const& args, char const* name) {
+    std::string const locks = "," + args.get_string("locks", "all") + ",";
+    return locks == ",all," || locks.find("," + std::string(name) + ",") != std::string::npos;
+  }
+
+  template <typename Lock>
+  void sweep(char const* name, BenchArgs const& args) {
+    if (!lock_selected(args, name)) {
+      return;
+    }
+    LockRunConfig config = lock_run_config(args);
+    for (size_t threads : lock_thread_counts(args)) {
+      if (Lock::MAX_THREADS && threads > static_cast<size_t>(Lock::MAX_THREADS)) {
+        break;
+      }
+      config.threads = threads;
+      Lock lock;
+      print_lock_result(name, config, run_lock(lock, config));
+    }
+  }
+
+  // The lock with every layout and memory order, the packed seq_cst one keeps the plain name
+  template <template <typename, typename> class Lock>
+  void sweep_policies(std::string const& name, BenchArgs const& args) {
+    sweep<Lock<PackedLayout, SeqCstOrder>>(name.c_str(), args);
+    sweep<Lock<PackedLayout, AcquireReleaseOrder>>((name + "-acqrel").c_str(), args);
+    sweep<Lock<PaddedLayout, SeqCstOrder>>((name + "-padded").c_str(), args);
+    sweep<Lock<PaddedLayout, AcquireReleaseOrder>>((name + "-padded-acqrel").c_str(), args);
+  }
+}
+
+void benchLocks(BenchArgs const& args) {
+  sweep<StdMutexLock>("std-mutex", args);
+  sweep_policies<RmwLock>("rmw", args);
+  sweep<AdaptiveMutexLock>("adaptive", args);
+  sweep_policies<TicketMutexLock>("ticket", args);
+  sweep<McsQueueLock>("mcs", args);
+  sweep<ClhQueueLock>("clh", args);
+  sweep_policies<RwWriteLock>("rwlock-write", args);
+  sweep_policies<RwReadLock>("rwlock-read", args);
+  sweep<MixedSide<TicketRw<>>>("rwlock-mixed", args);
+  sweep<ReadSide<SharedMutexRw>>("shared-mutex-read", args);
+  sweep<WriteSide<SharedMutexRw>>("shared-mutex-write", args);
+  sweep<MixedSide<SharedMutexRw>>("shared-mutex-mixed", args);
+  sweep<ReadSide<DistributedRw>>("distributed-read", args);
+  sweep<WriteSide<DistributedRw>>("distributed-write", args);
+  sweep<MixedSide<DistributedRw>>("distributed-mixed", args);
+  sweep_policies<Peterson2Lock>("peterson-2", args);
+  sweep<PetersonGreedyLock>("peterson-greedy", args);
+  sweep_policies<OptimizedPetersonLock>("peterson-optimized", args);
+}
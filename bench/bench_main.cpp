@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <cstring>
+
+#include "bench_list.h"
+#include "bench_util.h"
+
+namespace {
+  struct Benchmark {
+    char const* name;
+    void (*run)(BenchArgs const&);
+    char const* description;
+  };
+
+  Benchmark const BENCHMARKS[] = {
+    { "physical-memory", &benchPhysicalMemory,
+      "page-table store: std::unordered_map vs PhysicalMemory [--entries --queries --synthetic-entries --repeat]" },
+    { "tlb", &benchTlb,
+      "TLB and paging-structure caches in front of map_addr [--dump | --entries --queries --locality ...] "
+      "[--l1-entries --l1-ways --l2-entries --l2-ways --pml4-entries --pdpt-entries --pd-entries --replacement=lru|plru]" },
+    { "batch", &benchBatchTranslation,
+      "map_addr per query vs translate_batch [--dump | --entries --queries --locality ...] [--repeat]" },
+    { "pipeline", &benchTranslationPipeline,
+      "multithreaded order-preserving translation pipeline vs sequential [--dump | --entries --queries ...] "
+      "[--max-workers --chunk]" },
+    { "mapping-io", &benchMappingIo,
+      "dump parsing and result output: iostreams vs MappedFile/NumberParser/BufferedWriter [--file ...]" },
+    { "paging", &benchPagingModes,
+      "walks over 2 MiB/1 GiB pages and 5-level tables, depth statistics [--large-pages --la57 --honor-ps ...]" },
+    { "snapshot", &benchPageTableSnapshot,
+      "startup from the text dump vs the binary snapshot [--dump | --entries ...] [--file --snapshot --keep=1]" },
+    { "reverse", &benchReverseMapping,
+      "physical -> logical index: lazy build, shared frames, lookups [--dump | --entries --aliases ...]" },
+    { "paging-sim", &benchDemandPaging,
+      "demand paging with FIFO/LRU/Clock/ARC over skewed, loop and scan traces [--pages --frames --accesses --mappings]" },
+    { "rr", &benchRoundRobin,
+      "round-robin scheduler: ticks/s and events/s, std::queue globals vs RoundRobinScheduler [--threads --ticks --events]" },
+    { "rr-advance", &benchRoundRobinAdvance,
+      "round-robin advance(n): checked against n timer_tick() calls, and the cost of a long horizon "
+      "[--checks --max-ticks --threads --horizon --ticks]" },
+    { "mlfq", &benchMlfq,
+      "MLFQ vs round-robin: wait, response and wake latency of interactive threads next to CPU hogs, and ticks/s "
+      "[--hogs --interactive --burst --sleep --timeslice --levels --quantum --boost --per-thread=1]" },
+    { "cfs", &benchFair,
+      "vruntime-based fair scheduler vs round-robin: CPU share deviation by nice, wake latency, O(log n) ticks/s "
+      "[--threads --ticks --timeslice --latency --min-granularity --wakeup-granularity --max-threads]" },
+    { "smp", &benchMultiCpu,
+      "multi-CPU round-robin with per-CPU queues: migrations, idle time, imbalance and wake latency per placement "
+      "policy, with and without work stealing [--cpus --hogs --interactive --burst --sleep --hog-life --per-cpu=1]" },
+    { "replay", &benchTraceReplay,
+      "binary scheduler trace replayed against round-robin, MLFQ and CFS, JSON summaries "
+      "[--trace=<path> --events --threads --run --sleep --bursts --keep=1]" },
+    { "locks", &benchLocks,
+      "every mutex of src/threads and std::mutex on 1, 2, 4... pinned threads: throughput, acquire and handoff "
+      "latency percentiles and fairness as JSON lines [--locks=a,b --max-threads --cs --think --duration-ms --pin=0]" },
+#ifndef _WINDOWS
+    { "elf", &benchElfImage,
+      "ELF header and load size: whole-file read vs ElfImage [--file --padding-mb --repeat]" },
+    { "symbols", &benchSymbolIndex,
+      "ELF symbol index: name lookups and PC symbolization on 1, 2, 4... threads [--file --lib --pcs --max-threads]" },
+    { "elf-scan", &benchElfScanner,
+      "parallel ELF scan of a directory tree, files/s for 1, 2, 4... workers [--dir --format=csv|json --out --max-workers]" },
+    { "elf-load", &benchElfLoader,
+      "page-accurate load footprint vs space(), segments mapped with mmap and RSS after touching [--file --lib --map]" },
+    { "ldd", &benchElfDependencies,
+      "DT_NEEDED dependency graphs without the loader, per-binary vs shared library cache [--file --dir --max-files]" },
+#endif
+  };
+
+  void usage() {
+    printf("Usage: OS_bench <benchmark>... [--option=value]...\n\nBenchmarks (\"all\" runs every one):\n");
+    for (auto const& bench : BENCHMARKS) {
+      printf("  %-20s %s\n", bench.name, bench.description);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  BenchArgs const args(argc - 1, argv + 1);
+  if (args.positional().empty()) {
+    usage();
+    return 1;
+  }
+
+  for (auto const& name : args.positional()) {
+    bool found = false;
+    for (auto const& bench : BENCHMARKS) {
+      if (name == "all" || name == bench.name) {
+        printf("========== %s ==========\n", bench.name);
+        bench.run(args);
+        found = true;
+      }
+    }
+    if (!found) {
+      printf("Unknown benchmark: %s\n\n", name.c_str());
+      usage();
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,616 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+#include "../include/batch_translation.h"
+#include "../include/demand_paging.h"
+#include "../include/fast_io.h"
+#include "../include/page_table_snapshot.h"
+#include "../include/reverse_mapping.h"
+#include "../include/tlb.h"
+#include "../include/translation_pipeline.h"
+#include "bench_list.h"
+#include "bench_util.h"
+#include "page_table_dataset.h"
+
+namespace {
+  // The page-table store testMapping() used before PhysicalMemory
+  struct HashMapMemory {
+    std::unordered_map<uint64_t, uint64_t> map;
+
+    uint64_t load(uint64_t const key) const {
+      auto it = map.find(key);
+      return it != map.end() ? it->second : 0;
+    }
+
+    size_t memory_usage() const {
+      // libstdc++ node: next pointer + key + value + cached hash
+      return map.bucket_count() * sizeof(void*) + map.size() * 4 * sizeof(uint64_t);
+    }
+  };
+
+  // Returns the best time of 'repeat' passes over all queries
+  template <typename Memory>
+  double translate_all(Memory const& memory, PageTableDump const& dump, uint64_t repeat, std::vector<uint64_t>& results) {
+    double best = 1e100;
+    results.resize(dump.queries.size());
+    for (uint64_t r = 0; r < repeat; ++r) {
+      Stopwatch sw;
+      for (size_t i = 0; i < dump.queries.size(); ++i) {
+        results[i] = map_addr(dump.queries[i], dump.root_address, memory);
+      }
+      do_not_optimize(results.data());
+      best = std::min(best, sw.seconds());
+    }
+    return best;
+  }
+
+  // --dump=<path> reads a dump in the dataset_44327_15.txt format, otherwise a synthetic one is generated
+  PageTableDump load_or_generate(BenchArgs const& args, DumpShape shape) {
+    PageTableDump dump;
+    std::string const path = args.get_string("dump", "");
+    if (!path.empty()) {
+      if (!read_dump(path.c_str(), dump)) {
+        printf("Can't read %s\n", path.c_str());
+      }
+      printf("--- %s: %zu entries, %zu queries\n", path.c_str(), dump.entries.size(), dump.queries.size());
+      return dump;
+    }
+
+    shape.entry_count = args.get_u64("entries", shape.entry_count);
+    shape.query_count = args.get_u64("queries", shape.query_count);
+    shape.leaf_fill = static_cast<uint32_t>(args.get_u64("leaf-fill", shape.leaf_fill));
+    shape.mapped_ratio = args.get_double("mapped", shape.mapped_ratio);
+    shape.locality = args.get_double("locality", shape.locality);
+    shape.seed = args.get_u64("seed", shape.seed);
+    shape.large_page_ratio = args.get_double("large-pages", shape.large_page_ratio);
+    shape.la57 = args.get_u64("la57", shape.la57) != 0;
+    shape.alias_ratio = args.get_double("aliases", shape.alias_ratio);
+    printf("--- synthetic dump: %zu entries, %zu queries, leaf fill %u, locality %.2f, large pages %.2f%s\n",
+           shape.entry_count, shape.query_count, shape.leaf_fill, shape.locality, shape.large_page_ratio,
+           shape.la57 ? ", 5 levels" : "");
+    return generate_dump(shape);
+  }
+
+  void compare(char const* name, DumpShape const& shape, uint64_t repeat) {
+    printf("--- %s: %zu entries, %zu queries\n", name, shape.entry_count, shape.query_count);
+    PageTableDump const dump = generate_dump(shape);
+
+    Stopwatch sw;
+    HashMapMemory map;
+    for (auto const& entry : dump.entries) {
+      map.map[entry.first] = entry.second;
+    }
+    double const map_build = sw.seconds();
+
+    sw.restart();
+    PhysicalMemory memory;
+    memory.build(dump.entries);
+    double const image_build = sw.seconds();
+
+    std::vector<uint64_t> expected, actual;
+    double const map_time = translate_all(map, dump, repeat, expected);
+    double const image_time = translate_all(memory, dump, repeat, actual);
+    size_t const faults = std::count(expected.begin(), expected.end(), TRANSLATION_FAULT);
+
+    double const per_query = 1e9 / dump.queries.size();
+    printf("%-16s %10s %12s %12s %10s\n", "store", "build, ms", "translate, ms", "ns/query", "memory, MB");
+    printf("%-16s %10.1f %12.1f %12.1f %10.1f\n", "unordered_map",
+           map_build * 1e3, map_time * 1e3, map_time * per_query, map.memory_usage() / 1048576.0);
+    printf("%-16s %10.1f %12.1f %12.1f %10.1f\n", "PhysicalMemory",
+           image_build * 1e3, image_time * 1e3, image_time * per_query, memory.memory_usage() / 1048576.0);
+    printf("frames: %zu, faults: %zu, speedup: %.2fx, results %s\n", memory.frame_count(), faults,
+           map_time / image_time, expected == actual ? "match" : "DIFFER");
+  }
+}
+
+void benchPhysicalMemory(BenchArgs const& args) {
+  uint64_t const repeat = args.get_u64("repeat", 3);
+
+  DumpShape course;
+  course.entry_count = args.get_u64("entries", course.entry_count);
+  course.query_count = args.get_u64("queries", course.query_count);
+  compare("dataset_44327_15 shape", course, repeat);
+
+  DumpShape synthetic;
+  synthetic.entry_count = args.get_u64("synthetic-entries", 10000000);
+  synthetic.query_count = synthetic.entry_count;
+  synthetic.leaf_fill = 448;
+  synthetic.mapped_ratio = 0.9;
+  compare("synthetic dump", synthetic, repeat);
+}
+
+void benchTlb(BenchArgs const& args) {
+  DumpShape shape;
+  shape.entry_count = 1000000;
+  shape.query_count = 4000000;
+  shape.leaf_fill = 256;
+  shape.mapped_ratio = 0.9;
+  shape.locality = 0.8;
+  PageTableDump const dump = load_or_generate(args, shape);
+
+  PhysicalMemory memory;
+  memory.build(dump.entries);
+
+  TlbConfig config;
+  config.l1_entries = args.get_u64("l1-entries", config.l1_entries);
+  config.l1_ways = args.get_u64("l1-ways", config.l1_ways);
+  config.l2_entries = args.get_u64("l2-entries", config.l2_entries);
+  config.l2_ways = args.get_u64("l2-ways", config.l2_ways);
+  config.pml4_entries = args.get_u64("pml4-entries", config.pml4_entries);
+  config.pdpt_entries = args.get_u64("pdpt-entries", config.pdpt_entries);
+  config.pd_entries = args.get_u64("pd-entries", config.pd_entries);
+  config.replacement = args.get_string("replacement", "lru") == "plru" ? Replacement::PSEUDO_LRU : Replacement::LRU;
+  printf("L1 %zu entries %zu-way, L2 %zu entries %zu-way, PSC %zu/%zu/%zu, %s\n",
+         config.l1_entries, config.l1_ways, config.l2_entries, config.l2_ways,
+         config.pml4_entries, config.pdpt_entries, config.pd_entries,
+         config.replacement == Replacement::LRU ? "LRU" : "pseudo-LRU");
+
+  std::vector<uint64_t> expected;
+  double const walk_time = translate_all(memory, dump, 1, expected);
+
+  TranslationCache tlb(memory, dump.root_address, config);
+  std::vector<uint64_t> actual(dump.queries.size());
+  Stopwatch sw;
+  for (size_t i = 0; i < dump.queries.size(); ++i) {
+    actual[i] = tlb.translate(dump.queries[i]);
+  }
+  double const tlb_time = sw.seconds();
+
+  print_tlb_stats(tlb.stats(), stdout);
+  printf("full walks: %.1f ns/query, through TLB: %.1f ns/query, results %s\n",
+         walk_time * 1e9 / dump.queries.size(), tlb_time * 1e9 / dump.queries.size(),
+         expected == actual ? "match" : "DIFFER");
+}
+
+void benchBatchTranslation(BenchArgs const& args) {
+  DumpShape shape;
+  shape.entry_count = 10000000;
+  shape.query_count = 10000000;
+  shape.leaf_fill = 448;
+  shape.mapped_ratio = 0.9;
+  PageTableDump const dump = load_or_generate(args, shape);
+  uint64_t const repeat = args.get_u64("repeat", 3);
+
+  PhysicalMemory memory;
+  memory.build(dump.entries);
+
+  std::vector<uint64_t> expected;
+  double const single_time = translate_all(memory, dump, repeat, expected);
+
+  std::vector<uint64_t> actual(dump.queries.size());
+  double batch_time = 1e100;
+  for (uint64_t r = 0; r < repeat; ++r) {
+    Stopwatch sw;
+    translate_batch(memory, dump.root_address, dump.queries.data(), dump.queries.size(), actual.data());
+    batch_time = std::min(batch_time, sw.seconds());
+  }
+
+  std::string text;
+  Stopwatch sw;
+  format_translations(actual.data(), actual.size(), text);
+  double const format_time = sw.seconds();
+
+  double const per_query = 1e9 / dump.queries.size();
+  printf("map_addr per query: %.1f ns/query\n", single_time * per_query);
+  printf("translate_batch:    %.1f ns/query, speedup %.2fx, results %s\n",
+         batch_time * per_query, single_time / batch_time, expected == actual ? "match" : "DIFFER");
+  printf("format_translations: %.1f ns/query, %.1f MB\n", format_time * per_query, text.size() / 1048576.0);
+}
+
+void benchTranslationPipeline(BenchArgs const& args) {
+  DumpShape shape;
+  shape.entry_count = 10000000;
+  shape.query_count = 20000000;
+  shape.leaf_fill = 448;
+  shape.mapped_ratio = 0.9;
+  PageTableDump const dump = load_or_generate(args, shape);
+
+  PhysicalMemory memory;
+  memory.build(dump.entries);
+
+  std::vector<uint64_t> physical(dump.queries.size());
+  std::string expected;
+  Stopwatch sw;
+  translate_batch(memory, dump.root_address, dump.queries.data(), dump.queries.size(), physical.data());
+  format_translations(physical.data(), physical.size(), expected);
+  double const sequential = sw.seconds();
+  printf("%-10s %10s %12s %10s\n", "workers", "time, ms", "Mqueries/s", "speedup");
+  printf("%-10s %10.1f %12.2f %10s\n", "sequential", sequential * 1e3, dump.queries.size() / sequential / 1e6, "1.00x");
+
+  size_t const max_workers = args.get_u64("max-workers", 2 * std::max(1U, std::thread::hardware_concurrency()));
+  PipelineOptions options;
+  options.chunk_size = args.get_u64("chunk", options.chunk_size);
+  for (size_t workers = 1; workers <= max_workers; workers *= 2) {
+    options.workers = workers;
+    size_t next = 0;
+    auto source = [&](uint64_t* logical, size_t max_count) {
+      size_t const count = std::min(max_count, dump.queries.size() - next);
+      std::copy(dump.queries.begin() + next, dump.queries.begin() + next + count, logical);
+      next += count;
+      return count;
+    };
+    std::string actual;
+    actual.reserve(expected.size());
+    auto sink = [&](char const* data, size_t size) {
+      actual.append(data, size);
+    };
+
+    sw.restart();
+    run_translation_pipeline(memory, dump.root_address, source, sink, options);
+    double const time = sw.seconds();
+    printf("%-10zu %10.1f %12.2f %9.2fx %s\n", workers, time * 1e3, dump.queries.size() / time / 1e6,
+           sequential / time, actual == expected ? "" : "OUTPUT DIFFERS");
+  }
+}
+
+void benchMappingIo(BenchArgs const& args) {
+  DumpShape shape;
+  shape.entry_count = 5000000;
+  shape.query_count = 10000000;
+  shape.leaf_fill = 448;
+  shape.mapped_ratio = 0.9;
+  PageTableDump const dump = load_or_generate(args, shape);
+  std::string const path = args.get_string("file", "bench_mapping_io.txt");
+  std::string const out_path = path + ".out";
+  write_dump(dump, path.c_str());
+
+  size_t const numbers = 3 + 2 * dump.entries.size() + dump.queries.size();
+  std::vector<uint64_t> expected(numbers), actual(numbers);
+  Stopwatch sw;
+  {
+    std::ifstream in(path, std::ios::in);
+    for (auto& value : expected) {
+      in >> value;
+    }
+  }
+  double const stream_read = sw.seconds();
+
+  sw.restart();
+  size_t file_size = 0;
+  {
+    MappedFile in;
+    in.open(path.c_str());
+    file_size = in.size();
+    NumberParser parser(in.data(), in.data() + in.size());
+    parser.next(actual.data(), actual.size());
+  }
+  double const mapped_read = sw.seconds();
+
+  std::vector<uint64_t> physical(dump.queries.size());
+  PhysicalMemory memory;
+  memory.build(dump.entries);
+  translate_batch(memory, dump.root_address, dump.queries.data(), dump.queries.size(), physical.data());
+
+  sw.restart();
+  {
+    std::ofstream out(out_path, std::ios::out | std::ios::binary);
+    for (uint64_t ph_address : physical) {
+      if (ph_address == TRANSLATION_FAULT) {
+        out << "fault" << "\n";
+      } else {
+        out << ph_address << "\n";
+      }
+    }
+  }
+  double const stream_write = sw.seconds();
+
+  sw.restart();
+  size_t out_size = 0;
+  {
+    BufferedWriter out;
+    out.open(out_path.c_str());
+    for (uint64_t ph_address : physical) {
+      size_t const size = format_translation(ph_address, out.reserve(MAX_FORMATTED_TRANSLATION));
+      out.commit(size);
+      out_size += size;
+    }
+    out.close();
+  }
+  double const buffered_write = sw.seconds();
+  std::remove(path.c_str());
+  std::remove(out_path.c_str());
+
+  double const in_mb = file_size / 1048576.0, out_mb = out_size / 1048576.0;
+  printf("input: %.1f MB, %zu numbers; output: %.1f MB\n", in_mb, numbers, out_mb);
+  printf("%-32s %10s %10s\n", "path", "time, ms", "MB/s");
+  printf("%-32s %10.1f %10.1f\n", "ifstream >> uint64_t", stream_read * 1e3, in_mb / stream_read);
+  printf("%-32s %10.1f %10.1f %s\n", "MappedFile + NumberParser", mapped_read * 1e3, in_mb / mapped_read,
+         actual == expected ? "" : "NUMBERS DIFFER");
+  printf("%-32s %10.1f %10.1f\n", "ofstream << uint64_t", stream_write * 1e3, out_mb / stream_write);
+  printf("%-32s %10.1f %10.1f\n", "BufferedWriter", buffered_write * 1e3, out_mb / buffered_write);
+}
+
+void benchPagingModes(BenchArgs const& args) {
+  DumpShape shape;
+  shape.entry_count = 2000000;
+  shape.query_count = 4000000;
+  shape.leaf_fill = 256;
+  shape.mapped_ratio = 0.9;
+  shape.large_page_ratio = 0.3;
+  PageTableDump const dump = load_or_generate(args, shape);
+
+  PhysicalMemory memory;
+  memory.build(dump.entries);
+
+  PagingMode mode;
+  mode.large_pages = args.get_u64("honor-ps", 1) != 0;
+  mode.la57 = args.get_u64("la57", 0) != 0;
+  mode.present_bit_only = args.get_u64("present-bit-only", 0) != 0;
+  printf("walker: %d levels, PS %s, present check on bit%s\n", static_cast<int>(mode.depth()),
+         mode.large_pages ? "honored" : "ignored", mode.present_bit_only ? " 0" : "s 0..1");
+
+  WalkStats stats;
+  uint64_t checksum = 0;
+  Stopwatch sw;
+  for (uint64_t query : dump.queries) {
+    checksum += map_addr(query, dump.root_address, memory, mode, &stats);
+  }
+  double const time = sw.seconds();
+  do_not_optimize(checksum);
+
+  print_walk_stats(stats, stdout);
+  printf("%.1f ns/query\n", time * 1e9 / dump.queries.size());
+}
+
+void benchPageTableSnapshot(BenchArgs const& args) {
+  DumpShape shape;
+  shape.entry_count = 10000000;
+  shape.query_count = 1000000;
+  shape.leaf_fill = 448;
+  shape.mapped_ratio = 0.9;
+  PageTableDump const dump = load_or_generate(args, shape);
+  std::string const text_path = args.get_string("file", "bench_snapshot.txt");
+  std::string const snapshot_path = args.get_string("snapshot", text_path + ".bin");
+  write_dump(dump, text_path.c_str());
+
+  // Startup from the text dump: parse the entries and build the image
+  Stopwatch sw;
+  PhysicalMemory text_memory;
+  {
+    MappedFile in;
+    in.open(text_path.c_str());
+    NumberParser parser(in.data(), in.data() + in.size());
+    uint64_t table_size = 0, query_count = 0, root_address = 0;
+    parser.next(table_size);
+    parser.next(query_count);
+    parser.next(root_address);
+    std::vector<std::pair<uint64_t, uint64_t>> entries(table_size);
+    for (auto& entry : entries) {
+      parser.next(entry.first);
+      parser.next(entry.second);
+    }
+    text_memory.build(std::move(entries));
+  }
+  double const text_startup = sw.seconds();
+
+  sw.restart();
+  bool const converted = convert_dump_to_snapshot(text_path.c_str(), snapshot_path.c_str());
+  double const convert_time = sw.seconds();
+
+  sw.restart();
+  PageTableSnapshot snapshot;
+  bool const opened = snapshot.open(snapshot_path.c_str());
+  double const snapshot_startup = sw.seconds();
+
+  sw.restart();
+  PageTableSnapshot verified;
+  bool const verified_ok = verified.open(snapshot_path.c_str(), true);
+  double const verified_startup = sw.seconds();
+  if (!converted || !opened || !verified_ok) {
+    printf("snapshot failed: %s %s\n", snapshot.error(), verified.error());
+  }
+
+  std::vector<uint64_t> expected(dump.queries.size()), actual(dump.queries.size());
+  sw.restart();
+  translate_batch(text_memory, dump.root_address, dump.queries.data(), dump.queries.size(), expected.data());
+  double const warm_time = sw.seconds();
+  sw.restart();
+  translate_batch(snapshot.memory(), snapshot.root_address(), dump.queries.data(), dump.queries.size(), actual.data());
+  double const cold_time = sw.seconds();
+
+  printf("%-36s %10s\n", "step", "time, ms");
+  printf("%-36s %10.2f\n", "text dump: parse + build", text_startup * 1e3);
+  printf("%-36s %10.2f\n", "convert text dump to snapshot", convert_time * 1e3);
+  printf("%-36s %10.3f\n", "open snapshot (header + index checks)", snapshot_startup * 1e3);
+  printf("%-36s %10.2f\n", "open snapshot + data checksum", verified_startup * 1e3);
+  printf("%-36s %10.2f\n", "first batch on the built image", warm_time * 1e3);
+  printf("%-36s %10.2f %s\n", "first batch on the mapped snapshot", cold_time * 1e3,
+         expected == actual ? "" : "RESULTS DIFFER");
+
+  std::remove(text_path.c_str());
+  if (!args.get_u64("keep", 0)) {
+    std::remove(snapshot_path.c_str());
+  }
+}
+
+namespace {
+  // Two PML4 entries share one PDPT and two of its entries share one directory, so each of the two leaves is
+  // reachable through four logical pages. Returns true if the index reports exactly those, and they translate back.
+  bool check_shared_tables() {
+    uint64_t const pml4 = 0x1000, pdpt = 0x2000, directory = 0x3000, table = 0x4000;
+    std::vector<std::pair<uint64_t, uint64_t>> entries = {
+      { pml4 + 0 * 8, pdpt | 1 }, { pml4 + 1 * 8, pdpt | 1 },
+      { pdpt + 0 * 8, directory | 1 }, { pdpt + 3 * 8, directory | 1 },
+      { directory + 0 * 8, table | 1 },
+      { table + 5 * 8, 0x100000 | 1 }, { table + 7 * 8, 0x200000 | 1 },
+    };
+    PhysicalMemory memory;
+    memory.build(entries);
+    ReverseMapping reverse(memory, pml4);
+
+    bool ok = reverse.shared_tables() == 2 && reverse.page_count() == 8 && reverse.shared_frames().size() == 2;
+    uint64_t const leaves[][2] = { { 0x100000, 5 }, { 0x200000, 7 } };
+    for (auto const& leaf : leaves) {
+      uint64_t const physical = leaf[0] + 0x123;
+      std::vector<uint64_t> logical;
+      ok = ok && reverse.logical_addresses(physical, logical) == 4 && reverse.mapping_count(physical) == 4;
+      std::vector<uint64_t> expected;
+      for (uint64_t i : { 0, 1 }) {
+        for (uint64_t j : { 0, 3 }) {
+          expected.push_back(i << 39 | j << 30 | leaf[1] << 12 | 0x123);
+        }
+      }
+      std::sort(logical.begin(), logical.end());
+      ok = ok && logical == expected;
+      for (uint64_t address : logical) {
+        ok = ok && map_addr(address, pml4, memory, PagingMode()) == physical;
+      }
+    }
+    return ok;
+  }
+}
+
+void benchReverseMapping(BenchArgs const& args) {
+  printf("shared PML4/PDPT tables: %s\n", check_shared_tables() ? "all aliases found" : "ALIASES MISSING");
+
+  DumpShape shape;
+  shape.entry_count = 2000000;
+  shape.query_count = 1000000;
+  shape.leaf_fill = 256;
+  shape.mapped_ratio = 1.0;
+  shape.large_page_ratio = 0.05;
+  shape.alias_ratio = 0.01;
+  PageTableDump const dump = load_or_generate(args, shape);
+
+  PhysicalMemory memory;
+  memory.build(dump.entries);
+  PagingMode mode;
+  mode.large_pages = args.get_u64("honor-ps", 1) != 0;
+  mode.la57 = args.get_u64("la57", 0) != 0;
+
+  ReverseMapping reverse(memory, dump.root_address, mode);
+  Stopwatch sw;
+  size_t const pages = reverse.page_count();
+  double const build_time = sw.seconds();
+  sw.restart();
+  size_t const shared = reverse.shared_frames().size();
+  double const shared_time = sw.seconds();
+
+  // Every successful forward translation must come back through the reverse index
+  std::vector<std::pair<uint64_t, uint64_t>> round_trips;  // logical, physical
+  uint64_t const canonical_mask = mask(0, mode.la57 ? 56 : 47);
+  for (uint64_t query : dump.queries) {
+    uint64_t const ph_address = map_addr(query, dump.root_address, memory, mode);
+    if (ph_address != TRANSLATION_FAULT) {
+      round_trips.emplace_back(query & canonical_mask, ph_address);
+    }
+  }
+
+  std::vector<uint64_t> logical;
+  size_t found = 0, missing = 0;
+  sw.restart();
+  for (auto const& trip : round_trips) {
+    logical.clear();
+    found += reverse.logical_addresses(trip.second, logical);
+  }
+  double const lookup_time = sw.seconds();
+  for (auto const& trip : round_trips) {
+    logical.clear();
+    reverse.logical_addresses(trip.second, logical);
+    if (std::find(logical.begin(), logical.end(), trip.first) == logical.end()) {
+      ++missing;
+    }
+  }
+
+  printf("pages: %zu, shared frames: %zu, tables reached twice: %zu\n", pages, shared, reverse.shared_tables());
+  printf("lazy build: %.1f ms, shared frames: %.1f ms\n", build_time * 1e3, shared_time * 1e3);
+  printf("reverse lookups: %zu, %.1f ns/lookup, %.3f logical addresses per lookup, %zu round trips missing\n",
+         round_trips.size(), lookup_time * 1e9 / std::max<size_t>(1, round_trips.size()),
+         static_cast<double>(found) / std::max<size_t>(1, round_trips.size()), missing);
+}
+
+namespace {
+  // Page numbers of an access trace, 'pages' is the size of the working set
+  std::vector<uint64_t> make_paging_trace(std::string const& kind, size_t pages, size_t accesses, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<uint64_t> trace(accesses);
+    size_t scan = 0;
+    for (size_t i = 0; i < accesses; ++i) {
+      if (kind == "loop") {
+        // Sequential sweeps over the working set: the worst case for LRU and FIFO
+        trace[i] = i % pages;
+      } else if (kind == "scan" && (i / 4096) % 4 == 3) {
+        // Skewed accesses interrupted by one-shot scans of pages that are never used again
+        trace[i] = pages + scan++;
+      } else {
+        // Skewed: a small set of pages takes most of the accesses
+        trace[i] = static_cast<uint64_t>(pages * std::pow(uniform(rng), 4.0));
+      }
+    }
+    // Spread the pages over the address space, 16 pages apart, so the walk touches more tables
+    for (auto& page : trace) {
+      page = (page * 16) << PhysicalMemory::FRAME_SHIFT;
+    }
+    return trace;
+  }
+}
+
+void benchDemandPaging(BenchArgs const& args) {
+  // The trace and the pool need at least one page and one frame
+  size_t const pages = std::max<uint64_t>(args.get_u64("pages", 1 << 16), 1);
+  size_t const accesses = args.get_u64("accesses", 4000000);
+  uint64_t const seed = args.get_u64("seed", 1);
+  std::vector<size_t> frame_counts;
+  if (args.get_u64("frames", 0)) {
+    frame_counts.push_back(args.get_u64("frames", 0));
+  } else {
+    frame_counts = { std::max<size_t>(pages / 16, 1), std::max<size_t>(pages / 4, 1), std::max<size_t>(pages / 2, 1) };
+  }
+  EvictionPolicy const policies[] = { EvictionPolicy::FIFO, EvictionPolicy::LRU, EvictionPolicy::CLOCK,
+                                      EvictionPolicy::ARC };
+
+  for (std::string const kind : { "skewed", "loop", "scan" }) {
+    std::vector<uint64_t> const trace = make_paging_trace(kind, pages, accesses, seed);
+    printf("--- trace '%s': %zu accesses over %zu pages\n", kind.c_str(), accesses, pages);
+    for (size_t frames : frame_counts) {
+      for (EvictionPolicy policy : policies) {
+        PagingSimConfig config;
+        config.frame_count = frames;
+        config.policy = policy;
+        DemandPagingSimulator sim(config);
+        Stopwatch sw;
+        for (uint64_t logical : trace) {
+          do_not_optimize(sim.access(logical));
+        }
+        double const time = sw.seconds();
+        PagingSimStats const& stats = sim.stats();
+        printf("%6zu frames %-5s: fault rate %6.2f%%, evictions %9llu, %8.1f cycles/access, %5.1f ns/access\n",
+               frames, eviction_policy_name(policy), 100.0 * stats.faults / stats.accesses,
+               (unsigned long long) stats.evictions, static_cast<double>(stats.cycles) / stats.accesses,
+               time * 1e9 / accesses);
+      }
+    }
+  }
+
+  // Building a large address space: every mapping faults once, tables come from the arena
+  size_t const mappings = std::max<uint64_t>(args.get_u64("mappings", 2000000), 1);
+  std::mt19937_64 rng(seed);
+  std::vector<uint64_t> addresses(mappings);
+  for (auto& logical : addresses) {
+    logical = (rng() % (mappings * 8)) << PhysicalMemory::FRAME_SHIFT;
+  }
+  PagingSimConfig config;
+  config.frame_count = mappings;
+  config.policy = EvictionPolicy::CLOCK;
+  DemandPagingSimulator sim(config);
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass) {
+      sim.reset();
+    }
+    Stopwatch sw;
+    for (uint64_t logical : addresses) {
+      do_not_optimize(sim.access(logical));
+    }
+    double const time = sw.seconds();
+    printf("%s address space with %zu mappings: %.1f ms, %.1f ns/access, %llu tables, arena %.1f MB\n",
+           pass ? "rebuilt" : "built", mappings, time * 1e3, time * 1e9 / mappings,
+           (unsigned long long) sim.stats().tables_allocated, sim.arena().memory_usage() / 1048576.0);
+  }
+  print_paging_sim_stats(sim.stats(), stdout);
+}
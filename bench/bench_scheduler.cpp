@@ -0,0 +1,687 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "../include/threads/fair_scheduler.h"
+#include "../include/threads/mlfq_scheduler.h"
+#include "../include/threads/multi_cpu_scheduler.h"
+#include "../include/threads/round_robin_scheduler.h"
+#include "../include/threads/scheduler_stats.h"
+#include "../include/threads/scheduler_trace.h"
+#include "bench_list.h"
+#include "bench_util.h"
+
+namespace {
+  // The global round-robin from robin_round.cpp before RoundRobinScheduler, kept to compare against
+  class LegacyRoundRobin {
+  public:
+    explicit LegacyRoundRobin(int timeslice) : m_timeslice(timeslice) {}
+
+    void new_thread(int thread_id) {
+      if (m_current == -1) {
+        m_current = thread_id;
+        m_time = 0;
+      } else {
+        m_pool.push(thread_id);
+      }
+    }
+    void exit_thread() { switch_to_next(); }
+    void block_thread() { switch_to_next(); }
+    void wake_thread(int thread_id) { new_thread(thread_id); }
+    void timer_tick() {
+      ++m_time;
+      if (m_time == m_timeslice) {
+        if (!m_pool.empty()) {
+          m_pool.push(m_current);
+          m_current = m_pool.front();
+          m_pool.pop();
+        }
+        m_time = 0;
+      }
+    }
+    int current_thread() const { return m_current; }
+
+  private:
+    void switch_to_next() {
+      if (m_pool.empty()) {
+        m_current = -1;
+      } else {
+        m_current = m_pool.front();
+        m_pool.pop();
+        m_time = 0;
+      }
+    }
+
+    int m_current = -1;
+    uint64_t m_timeslice;
+    uint64_t m_time = 0;
+    std::queue<int> m_pool;
+  };
+
+  struct RunResult {
+    double tick_time = 0;
+    double event_time = 0;
+    uint64_t checksum = 0;
+  };
+
+  // 'threads' runnable threads, 'ticks' timer ticks, then 'events' block/wake and exit/new pairs
+  template <typename Scheduler>
+  RunResult run_round_robin(Scheduler& scheduler, size_t threads, size_t ticks, size_t events) {
+    RunResult res;
+    for (size_t i = 0; i < threads; ++i) {
+      scheduler.new_thread(static_cast<int>(i));
+    }
+
+    Stopwatch sw;
+    for (size_t i = 0; i < ticks; ++i) {
+      scheduler.timer_tick();
+      res.checksum += static_cast<uint64_t>(scheduler.current_thread());
+    }
+    res.tick_time = sw.seconds();
+
+    // Up to 1024 blocked threads at a time, woken in the order they blocked
+    std::vector<int> blocked(1024);
+    size_t blocked_head = 0, blocked_count = 0;
+    int next_id = static_cast<int>(threads);
+    sw.restart();
+    for (size_t i = 0; i < events; i += 2) {
+      if (i % 8 == 0) {
+        scheduler.exit_thread();
+        scheduler.new_thread(next_id++);
+      } else if (blocked_count < blocked.size() && (i % 8) < 6) {
+        blocked[(blocked_head + blocked_count++) % blocked.size()] = scheduler.current_thread();
+        scheduler.block_thread();
+        scheduler.timer_tick();
+      } else if (blocked_count) {
+        scheduler.wake_thread(blocked[blocked_head]);
+        blocked_head = (blocked_head + 1) % blocked.size();
+        --blocked_count;
+        scheduler.timer_tick();
+      }
+      res.checksum += static_cast<uint64_t>(scheduler.current_thread());
+    }
+    res.event_time = sw.seconds();
+    return res;
+  }
+
+  // Threads 0..interactive-1 run 'burst' ticks and then sleep about 'sleep' ticks, the rest are CPU hogs that
+  // never block. The hogs are created first, so the interactive threads start behind all of them.
+  struct MixedWorkload {
+    size_t hogs = 0;
+    size_t interactive = 0;
+    uint64_t burst = 1;
+    uint64_t sleep = 20;
+    uint64_t ticks = 0;
+  };
+
+  template <typename Scheduler>
+  void run_mixed(TrackedScheduler<Scheduler>& scheduler, MixedWorkload const& workload) {
+    int const interactive = static_cast<int>(workload.interactive);
+    std::vector<uint64_t> left(workload.interactive, workload.burst);  // ticks left of the current burst
+    using Wakeup = std::pair<uint64_t, int>;
+    std::priority_queue<Wakeup, std::vector<Wakeup>, std::greater<Wakeup>> sleeping;
+    for (size_t i = 0; i < workload.hogs; ++i) {
+      scheduler.new_thread(interactive + static_cast<int>(i));
+    }
+    for (int i = 0; i < interactive; ++i) {
+      scheduler.new_thread(i);
+    }
+
+    for (uint64_t tick = 0; tick < workload.ticks; ++tick) {
+      while (!sleeping.empty() && sleeping.top().first <= scheduler.now()) {
+        scheduler.wake_thread(sleeping.top().second);
+        sleeping.pop();
+      }
+      int current = scheduler.current_thread();
+      while (current >= 0 && current < interactive && left[current] == 0) {
+        left[current] = workload.burst;
+        // A little jitter so the sleepers don't wake in lockstep
+        sleeping.emplace(scheduler.now() + workload.sleep + current % 7, current);
+        scheduler.block_thread();
+        current = scheduler.current_thread();
+      }
+      scheduler.timer_tick();
+      if (current >= 0 && current < interactive) {
+        --left[current];
+      }
+    }
+  }
+
+  template <typename Scheduler>
+  void report_mixed(char const* name, TrackedScheduler<Scheduler> const& scheduler, MixedWorkload const& workload,
+                    bool per_thread)
+  {
+    struct Group {
+      uint64_t threads = 0, cpu = 0, wait = 0, response = 0, wakeups = 0, wake_latency = 0, max_wake_latency = 0;
+    } groups[2];  // interactive, hogs
+    auto const& stats = scheduler.stats();
+    for (size_t id = 0; id < stats.size(); ++id) {
+      ThreadStats const& thread = stats[id];
+      Group& group = groups[id < workload.interactive ? 0 : 1];
+      ++group.threads;
+      group.cpu += thread.cpu;
+      group.wait += thread.wait;
+      group.response += thread.started ? thread.response() : scheduler.now() - thread.arrival;
+      group.wakeups += thread.wakeups;
+      group.wake_latency += thread.wake_latency;
+      group.max_wake_latency = std::max(group.max_wake_latency, thread.max_wake_latency);
+    }
+    printf("%s: %llu context switches, %llu idle ticks\n", name,
+           static_cast<unsigned long long>(scheduler.context_switches()),
+           static_cast<unsigned long long>(scheduler.idle_ticks()));
+    char const* const group_names[] = { "interactive", "hogs" };
+    for (int i = 0; i < 2; ++i) {
+      Group const& group = groups[i];
+      if (!group.threads) {
+        continue;
+      }
+      printf("  %-11s cpu %5.1f%%, wait %9.1f, response %8.1f, wakeups %8llu, wake latency avg %7.2f max %6llu\n",
+             group_names[i], 100.0 * group.cpu / scheduler.now(), double(group.wait) / group.threads,
+             double(group.response) / group.threads, static_cast<unsigned long long>(group.wakeups),
+             group.wakeups ? double(group.wake_latency) / group.wakeups : 0.0,
+             static_cast<unsigned long long>(group.max_wake_latency));
+    }
+    if (per_thread) {
+      printf("  %6s %-11s %8s %8s %9s %9s %8s %9s\n", "thread", "kind", "arrival", "response", "cpu", "wait",
+             "wakeups", "wake avg");
+      for (size_t id = 0; id < stats.size(); ++id) {
+        ThreadStats const& thread = stats[id];
+        printf("  %6zu %-11s %8llu %8llu %9llu %9llu %8llu %9.2f\n", id,
+               group_names[id < workload.interactive ? 0 : 1], static_cast<unsigned long long>(thread.arrival),
+               static_cast<unsigned long long>(thread.started ? thread.response() : 0),
+               static_cast<unsigned long long>(thread.cpu), static_cast<unsigned long long>(thread.wait),
+               static_cast<unsigned long long>(thread.wakeups),
+               thread.wakeups ? double(thread.wake_latency) / thread.wakeups : 0.0);
+      }
+    }
+  }
+
+  // Only FairScheduler knows about nice values
+  template <typename Scheduler>
+  void create_thread(TrackedScheduler<Scheduler>& scheduler, int thread_id, int) {
+    scheduler.new_thread(thread_id);
+  }
+
+  void create_thread(TrackedScheduler<FairScheduler>& scheduler, int thread_id, int nice) {
+    scheduler.new_thread(thread_id, nice);
+  }
+
+  // CPU hogs with the given nice values for 'ticks' ticks, the fair share of each follows its Linux weight
+  template <typename Scheduler>
+  FairnessReport run_hogs(TrackedScheduler<Scheduler>& scheduler, std::vector<int> const& nice, uint64_t ticks) {
+    std::vector<double> weights(nice.size());
+    for (size_t i = 0; i < nice.size(); ++i) {
+      create_thread(scheduler, static_cast<int>(i), nice[i]);
+      weights[i] = FairScheduler::nice_to_weight(nice[i]);
+    }
+    for (uint64_t tick = 0; tick < ticks; ++tick) {
+      scheduler.timer_tick();
+    }
+    return fairness_report(scheduler.stats(), weights);
+  }
+
+  void print_fairness(char const* name, FairnessReport const& report) {
+    printf("  %-12s share deviation min %+7.2f%%, max %+7.2f%%, mean |dev| %6.2f%%\n", name,
+           100 * report.min_deviation, 100 * report.max_deviation, 100 * report.mean_abs_deviation);
+  }
+
+  // Interactive threads 0..interactive-1 run 'burst' ticks and sleep, woken from CPU (id % cpus) like by the
+  // completion of their I/O there. Hogs run 'hog_life' ticks of CPU each and exit, and a new hog takes their place.
+  struct SmpWorkload {
+    size_t hogs = 12;
+    size_t interactive = 32;
+    uint64_t burst = 2;
+    uint64_t sleep = 10;
+    uint64_t hog_life = 5000;
+    uint64_t ticks = 0;
+  };
+
+  struct SmpResult {
+    uint64_t wakeups = 0;
+    uint64_t wake_latency = 0;  // ticks from wake_thread to the first tick on a CPU, summed
+    uint64_t hogs_done = 0;
+  };
+
+  SmpResult run_smp(MultiCpuScheduler& scheduler, SmpWorkload const& workload) {
+    constexpr uint64_t NOT_WOKEN = ~uint64_t(0);
+    int const interactive = static_cast<int>(workload.interactive);
+    int const cpus = scheduler.cpus();
+    std::vector<uint64_t> ran;  // by thread id: ticks of the current burst, or of the whole life for a hog
+    std::vector<uint64_t> woken_at(workload.interactive, NOT_WOKEN);
+    using Wakeup = std::pair<uint64_t, int>;
+    std::priority_queue<Wakeup, std::vector<Wakeup>, std::greater<Wakeup>> sleeping;
+    std::vector<int> running(cpus);
+    int next_id = 0;
+    auto const create = [&]() {
+      ran.push_back(0);
+      scheduler.new_thread(next_id++);
+    };
+    for (int i = 0; i < interactive; ++i) {
+      create();
+    }
+    for (size_t i = 0; i < workload.hogs; ++i) {
+      create();
+    }
+
+    SmpResult res;
+    for (uint64_t now = 0; now < workload.ticks; ++now) {
+      while (!sleeping.empty() && sleeping.top().first <= now) {
+        int const id = sleeping.top().second;
+        sleeping.pop();
+        woken_at[id] = now;
+        ++res.wakeups;
+        scheduler.wake_thread(id, id % cpus);
+      }
+      for (int cpu = 0; cpu < cpus; ++cpu) {
+        for (;;) {
+          int const current = scheduler.current_thread(cpu);
+          if (current == -1) {
+            break;
+          }
+          if (current < interactive && ran[current] >= workload.burst) {
+            ran[current] = 0;
+            sleeping.emplace(now + workload.sleep + current % 7, current);
+            scheduler.block_thread(cpu);
+          } else if (current >= interactive && ran[current] >= workload.hog_life) {
+            ++res.hogs_done;
+            scheduler.exit_thread(cpu);
+            create();
+          } else {
+            break;
+          }
+        }
+        running[cpu] = scheduler.current_thread(cpu);
+        if (running[cpu] != -1 && running[cpu] < interactive && woken_at[running[cpu]] != NOT_WOKEN) {
+          res.wake_latency += now - woken_at[running[cpu]];
+          woken_at[running[cpu]] = NOT_WOKEN;
+        }
+      }
+      scheduler.timer_tick();
+      for (int cpu = 0; cpu < cpus; ++cpu) {
+        if (running[cpu] != -1) {
+          ++ran[running[cpu]];
+        }
+      }
+    }
+    return res;
+  }
+
+  // 'slots' threads at a time, each runs about 'run' ticks between sleeps of about 'sleep' ticks for 'bursts'
+  // bursts and exits, then a new thread takes its slot. Returns false if the trace can't be written.
+  bool generate_trace(char const* path, uint64_t events, size_t slots, uint64_t run, uint64_t sleep,
+                      uint64_t bursts)
+  {
+    enum State { NEW, RUNNING, SLEEPING };
+    struct Slot {
+      int thread;
+      State state;
+      uint64_t bursts_left;
+    };
+    std::mt19937_64 rng(42);
+    auto const around = [&rng](uint64_t mean) { return 1 + rng() % (2 * std::max<uint64_t>(mean, 1) - 1); };
+
+    TraceWriter writer;
+    if (!writer.open(path)) {
+      return false;
+    }
+    std::vector<Slot> states(slots);
+    using Next = std::pair<uint64_t, size_t>;  // time, slot
+    std::priority_queue<Next, std::vector<Next>, std::greater<Next>> next;
+    int next_id = 0;
+    for (size_t i = 0; i < slots; ++i) {
+      states[i] = Slot { next_id++, NEW, bursts };
+      next.emplace(rng() % (sleep + 1), i);
+    }
+    while (writer.event_count() < events) {
+      uint64_t const time = next.top().first;
+      size_t const i = next.top().second;
+      next.pop();
+      Slot& slot = states[i];
+      if (slot.state == NEW) {
+        writer.add(TraceEventKind::CREATE, time, slot.thread);
+        slot.state = RUNNING;
+        next.emplace(time + around(run), i);
+      } else if (slot.state == SLEEPING) {
+        writer.add(TraceEventKind::WAKE, time, slot.thread);
+        slot.state = RUNNING;
+        next.emplace(time + around(run), i);
+      } else if (--slot.bursts_left == 0) {
+        writer.add(TraceEventKind::EXIT, time, slot.thread);
+        slot = Slot { next_id++, NEW, bursts };
+        next.emplace(time + around(sleep), i);
+      } else {
+        writer.add(TraceEventKind::BLOCK, time, slot.thread);
+        slot.state = SLEEPING;
+        next.emplace(time + around(sleep), i);
+      }
+    }
+    return writer.close();
+  }
+
+  template <typename Scheduler>
+  void replay_and_print(char const* policy, SchedulerTrace const& trace, Scheduler& scheduler) {
+    ReplaySummary summary;
+    summary.policy = policy;
+    Stopwatch sw;
+    replay_trace(trace.events(), trace.event_count(), scheduler, summary);
+    summary.seconds = sw.seconds();
+    std::string out;
+    format_replay_summary(summary, out);
+    fputs(out.c_str(), stdout);
+  }
+}
+
+void benchRoundRobin(BenchArgs const& args) {
+  size_t const threads = args.get_u64("threads", 100000);
+  size_t const ticks = args.get_u64("ticks", 20000000);
+  size_t const events = args.get_u64("events", 20000000);
+  int const timeslice = static_cast<int>(args.get_u64("timeslice", 1));
+  printf("%zu threads, timeslice %d, %zu ticks, %zu events\n", threads, timeslice, ticks, events);
+
+  LegacyRoundRobin legacy(timeslice);
+  RunResult const before = run_round_robin(legacy, threads, ticks, events);
+  RoundRobinScheduler scheduler(timeslice, threads);
+  RunResult const after = run_round_robin(scheduler, threads, ticks, events);
+  printf("std::queue globals : %6.1f M ticks/s, %6.1f M events/s\n", ticks / before.tick_time / 1e6,
+         events / before.event_time / 1e6);
+  printf("RoundRobinScheduler: %6.1f M ticks/s, %6.1f M events/s, schedules %s\n", ticks / after.tick_time / 1e6,
+         events / after.event_time / 1e6, before.checksum == after.checksum ? "match" : "DIFFER");
+
+  // Independent schedulers on parallel simulation threads
+  size_t const max_instances = args.get_u64("max-instances", std::max(1u, std::thread::hardware_concurrency()));
+  for (size_t instances = 1; instances <= max_instances; instances *= 2) {
+    std::vector<std::thread> workers;
+    std::vector<RunResult> results(instances);
+    Stopwatch sw;
+    for (size_t i = 0; i < instances; ++i) {
+      workers.emplace_back([&, i]() {
+        RoundRobinScheduler local(timeslice, threads);
+        results[i] = run_round_robin(local, threads, ticks, 0);
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    double const time = sw.seconds();
+    printf("%zu parallel schedulers: %.1f M ticks/s in total\n", instances, instances * ticks / time / 1e6);
+  }
+}
+
+void benchMlfq(BenchArgs const& args) {
+  MixedWorkload workload;
+  workload.hogs = args.get_u64("hogs", 8);
+  workload.interactive = args.get_u64("interactive", 8);
+  workload.burst = std::max<uint64_t>(args.get_u64("burst", 1), 1);
+  workload.sleep = args.get_u64("sleep", 20);
+  workload.ticks = args.get_u64("ticks", 1000000);
+  int const timeslice = static_cast<int>(args.get_u64("timeslice", 10));
+  MlfqConfig config;
+  config.levels = static_cast<int>(args.get_u64("levels", 8));
+  config.base_quantum = static_cast<int>(args.get_u64("quantum", 1));
+  config.boost_period = args.get_u64("boost", 1000);
+  bool const per_thread = args.get_u64("per-thread", 0) != 0;
+  printf("%zu CPU hogs, %zu interactive threads (burst %llu, sleep %llu), %llu ticks\n", workload.hogs,
+         workload.interactive, static_cast<unsigned long long>(workload.burst),
+         static_cast<unsigned long long>(workload.sleep), static_cast<unsigned long long>(workload.ticks));
+  printf("RR timeslice %d; MLFQ %d levels, quantum %d doubling per level, boost every %llu ticks\n\n", timeslice,
+         config.levels, config.base_quantum, static_cast<unsigned long long>(config.boost_period));
+
+  size_t const threads = workload.hogs + workload.interactive;
+  {
+    TrackedScheduler<RoundRobinScheduler> rr(timeslice, threads);
+    run_mixed(rr, workload);
+    report_mixed("round-robin", rr, workload, per_thread);
+  }
+  {
+    TrackedScheduler<MlfqScheduler> mlfq(config, threads);
+    run_mixed(mlfq, workload);
+    report_mixed("MLFQ", mlfq, workload, per_thread);
+    printf("  %llu demotions, %llu boosts\n", static_cast<unsigned long long>(mlfq.scheduler().demotions()),
+           static_cast<unsigned long long>(mlfq.scheduler().boosts()));
+  }
+
+  // Cost of the event API itself with many threads: the pick is a bit scan, a boost splices whole levels
+  size_t const many = args.get_u64("threads", 100000);
+  size_t const ticks = args.get_u64("speed-ticks", 20000000);
+  size_t const events = args.get_u64("events", 20000000);
+  RoundRobinScheduler rr(timeslice, many);
+  RunResult const rr_speed = run_round_robin(rr, many, ticks, events);
+  MlfqScheduler mlfq(config, many);
+  RunResult const mlfq_speed = run_round_robin(mlfq, many, ticks, events);
+  printf("\n%zu threads:\n", many);
+  printf("RoundRobinScheduler: %6.1f M ticks/s, %6.1f M events/s\n", ticks / rr_speed.tick_time / 1e6,
+         events / rr_speed.event_time / 1e6);
+  printf("MlfqScheduler      : %6.1f M ticks/s, %6.1f M events/s\n", ticks / mlfq_speed.tick_time / 1e6,
+         events / mlfq_speed.event_time / 1e6);
+}
+
+void benchFair(BenchArgs const& args) {
+  size_t const threads = args.get_u64("threads", 1000);
+  uint64_t const ticks = args.get_u64("ticks", 1000000);
+  int const timeslice = static_cast<int>(args.get_u64("timeslice", 10));
+  FairConfig config;
+  config.latency = args.get_u64("latency", 6);
+  config.min_granularity = args.get_u64("min-granularity", 1);
+  config.wakeup_granularity = args.get_u64("wakeup-granularity", 1);
+  printf("CFS latency %llu, min granularity %llu, wakeup granularity %llu; RR timeslice %d\n",
+         static_cast<unsigned long long>(config.latency), static_cast<unsigned long long>(config.min_granularity),
+         static_cast<unsigned long long>(config.wakeup_granularity), timeslice);
+
+  // Fairness of CPU hogs, first all at nice 0, then spread over nice -5..5
+  for (int spread = 0; spread < 2; ++spread) {
+    std::vector<int> nice(threads);
+    for (size_t i = 0; i < threads; ++i) {
+      nice[i] = spread ? static_cast<int>(i % 11) - 5 : 0;
+    }
+    printf("\n%zu CPU hogs at %s, %llu ticks:\n", threads, spread ? "nice -5..5" : "nice 0",
+           static_cast<unsigned long long>(ticks));
+    TrackedScheduler<RoundRobinScheduler> rr(timeslice, threads);
+    print_fairness("round-robin", run_hogs(rr, nice, ticks));
+    TrackedScheduler<FairScheduler> cfs(config, threads);
+    print_fairness("CFS", run_hogs(cfs, nice, ticks));
+  }
+
+  // Interactive threads next to hogs, woken threads start at min_vruntime and preempt the hog
+  MixedWorkload workload;
+  workload.hogs = args.get_u64("hogs", 8);
+  workload.interactive = args.get_u64("interactive", 8);
+  workload.ticks = ticks;
+  printf("\n%zu CPU hogs, %zu interactive threads (burst %llu, sleep %llu):\n", workload.hogs,
+         workload.interactive, static_cast<unsigned long long>(workload.burst),
+         static_cast<unsigned long long>(workload.sleep));
+  {
+    TrackedScheduler<RoundRobinScheduler> rr(timeslice, workload.hogs + workload.interactive);
+    run_mixed(rr, workload);
+    report_mixed("round-robin", rr, workload, false);
+  }
+  {
+    TrackedScheduler<FairScheduler> cfs(config, workload.hogs + workload.interactive);
+    run_mixed(cfs, workload);
+    report_mixed("CFS", cfs, workload, false);
+  }
+
+  // Pick-next is O(log n) in the tree
+  size_t const speed_ticks = args.get_u64("speed-ticks", 5000000);
+  printf("\n");
+  for (size_t many = 1000; many <= args.get_u64("max-threads", 1000000); many *= 10) {
+    FairScheduler cfs(config, many);
+    RunResult const speed = run_round_robin(cfs, many, speed_ticks, speed_ticks);
+    printf("%8zu threads: %6.1f M ticks/s, %6.1f M events/s\n", many, speed_ticks / speed.tick_time / 1e6,
+           speed_ticks / speed.event_time / 1e6);
+  }
+}
+
+void benchMultiCpu(BenchArgs const& args) {
+  SmpWorkload workload;
+  workload.hogs = args.get_u64("hogs", 12);
+  workload.interactive = args.get_u64("interactive", 32);
+  workload.burst = std::max<uint64_t>(args.get_u64("burst", 2), 1);
+  workload.sleep = args.get_u64("sleep", 10);
+  workload.hog_life = std::max<uint64_t>(args.get_u64("hog-life", 5000), 1);
+  workload.ticks = args.get_u64("ticks", 200000);
+  int const cpus = static_cast<int>(args.get_u64("cpus", 8));
+  bool const per_cpu = args.get_u64("per-cpu", 0) != 0;
+  printf("%d CPUs, %zu hogs (%llu ticks each), %zu interactive threads (burst %llu, sleep %llu), %llu ticks\n",
+         cpus, workload.hogs, static_cast<unsigned long long>(workload.hog_life), workload.interactive,
+         static_cast<unsigned long long>(workload.burst), static_cast<unsigned long long>(workload.sleep),
+         static_cast<unsigned long long>(workload.ticks));
+  printf("%-20s %10s %8s %20s %15s %12s %10s\n", "placement", "migrations", "steals", "idle% min/avg/max",
+         "imbalance avg/max", "wake latency", "hogs done");
+
+  struct Variant {
+    WakePlacement placement;
+    bool steal;
+  } const variants[] = {
+    { WakePlacement::PREVIOUS, false },
+    { WakePlacement::PREVIOUS, true },
+    { WakePlacement::AFFINE, true },
+    { WakePlacement::IDLEST, true },
+  };
+  for (auto const& variant : variants) {
+    MultiCpuConfig config;
+    config.cpus = cpus;
+    config.timeslice = static_cast<int>(args.get_u64("timeslice", 4));
+    config.steal = variant.steal;
+    config.placement = variant.placement;
+    MultiCpuScheduler scheduler(config, workload.hogs + workload.interactive);
+    SmpResult const res = run_smp(scheduler, workload);
+
+    uint64_t steals = 0;
+    double idle_min = 100, idle_max = 0, idle_sum = 0;
+    for (int cpu = 0; cpu < cpus; ++cpu) {
+      CpuStats const& stats = scheduler.cpu_stats(cpu);
+      double const idle = 100.0 * stats.idle_ticks / workload.ticks;
+      idle_min = std::min(idle_min, idle);
+      idle_max = std::max(idle_max, idle);
+      idle_sum += idle;
+      steals += stats.steals;
+    }
+    char name[32], idle[32], imbalance[32];
+    snprintf(name, sizeof(name), "%s%s", wake_placement_name(variant.placement), variant.steal ? "+steal" : "");
+    snprintf(idle, sizeof(idle), "%.1f/%.1f/%.1f", idle_min, idle_sum / cpus, idle_max);
+    snprintf(imbalance, sizeof(imbalance), "%.2f/%zu", scheduler.average_imbalance(), scheduler.max_imbalance());
+    printf("%-20s %10llu %8llu %20s %15s %12.2f %10llu\n", name,
+           static_cast<unsigned long long>(scheduler.migrations()), static_cast<unsigned long long>(steals), idle,
+           imbalance, res.wakeups ? double(res.wake_latency) / res.wakeups : 0.0,
+           static_cast<unsigned long long>(res.hogs_done));
+    if (per_cpu) {
+      for (int cpu = 0; cpu < cpus; ++cpu) {
+        CpuStats const& stats = scheduler.cpu_stats(cpu);
+        printf("  cpu %3d: idle %8llu, busy %8llu, steals %6llu\n", cpu,
+               static_cast<unsigned long long>(stats.idle_ticks), static_cast<unsigned long long>(stats.busy_ticks),
+               static_cast<unsigned long long>(stats.steals));
+      }
+    }
+  }
+}
+
+void benchTraceReplay(BenchArgs const& args) {
+  // An existing --trace is only read, a missing one is generated; without --trace a scratch file is generated
+  std::string const given = args.get_string("trace", "");
+  std::string const path = given.empty() ? "bench_sched.trace" : given;
+  uint64_t const events = args.get_u64("events", 10000000);
+  struct stat st {};
+  bool const generated = given.empty() || (stat(given.c_str(), &st) != 0 && errno == ENOENT);
+  SchedulerTrace trace;
+  if (generated) {
+    size_t const slots = args.get_u64("threads", 16);
+    if (slots == 0) {
+      printf("--threads must be at least 1\n");
+      return;
+    }
+    uint64_t const run = args.get_u64("run", 2), sleep = args.get_u64("sleep", 40);
+    uint64_t const bursts = std::max<uint64_t>(args.get_u64("bursts", 50), 1);
+    Stopwatch sw;
+    if (!generate_trace(path.c_str(), events, slots, run, sleep, bursts) || !trace.open(path.c_str())) {
+      printf("can't write %s: %s\n", path.c_str(), trace.error());
+      return;
+    }
+    printf("generated %zu events (%zu threads at a time, run ~%llu, sleep ~%llu, %llu bursts) in %.2f s, %.1f MB\n",
+           trace.event_count(), slots, static_cast<unsigned long long>(run), static_cast<unsigned long long>(sleep),
+           static_cast<unsigned long long>(bursts), sw.seconds(), trace.event_count() * sizeof(TraceEvent) / 1e6);
+  } else if (!trace.open(path.c_str())) {
+    printf("can't replay %s: %s\n", path.c_str(), trace.error());
+    return;
+  } else {
+    printf("replaying %s: %zu events\n", path.c_str(), trace.event_count());
+  }
+
+  RoundRobinScheduler rr(static_cast<int>(args.get_u64("timeslice", 4)));
+  replay_and_print("round-robin", trace, rr);
+  MlfqScheduler mlfq;
+  replay_and_print("mlfq", trace, mlfq);
+  FairScheduler cfs;
+  replay_and_print("cfs", trace, cfs);
+
+  if (generated && !args.get_u64("keep", 0)) {
+    std::remove(path.c_str());
+  }
+}
+
+void benchRoundRobinAdvance(BenchArgs const& args) {
+  size_t const checks = args.get_u64("checks", 2000);
+  uint64_t const max_ticks = args.get_u64("max-ticks", 100000);
+  std::mt19937_64 rng(7);
+
+  // advance(n) against n timer_tick() calls on random states, compared by the next full turn of the ring
+  size_t mismatches = 0;
+  for (size_t check = 0; check < checks; ++check) {
+    int const timeslice = static_cast<int>(rng() % 13);  // 0 never preempts
+    size_t const threads = rng() % 4 == 0 ? 0 : rng() % 300;
+    RoundRobinScheduler advanced(timeslice);
+    for (size_t i = 0; i < threads; ++i) {
+      advanced.new_thread(static_cast<int>(i));
+    }
+    for (uint64_t i = rng() % 50; i > 0; --i) {
+      advanced.timer_tick();
+    }
+    RoundRobinScheduler ticked = advanced;
+    uint64_t const ticks = rng() % max_ticks;
+    advanced.advance(ticks);
+    for (uint64_t i = 0; i < ticks; ++i) {
+      ticked.timer_tick();
+    }
+    bool same = advanced.current_thread() == ticked.current_thread() && advanced.next_switch() == ticked.next_switch();
+    for (size_t i = 0; same && i < (threads + 1) * std::max(timeslice, 1); ++i) {
+      advanced.timer_tick();
+      ticked.timer_tick();
+      same = advanced.current_thread() == ticked.current_thread();
+    }
+    mismatches += same ? 0 : 1;
+  }
+  printf("%zu random states: advance(n) %s n timer_tick() calls\n", checks,
+         mismatches ? "DIFFERS from" : "matches");
+
+  // Cost of a long horizon
+  size_t const threads = args.get_u64("threads", 100000);
+  uint64_t const horizon = args.get_u64("horizon", 1000000000000ULL);
+  uint64_t const sample = args.get_u64("ticks", 100000000);
+  printf("%zu threads, horizon of %llu ticks:\n", threads, static_cast<unsigned long long>(horizon));
+  for (int timeslice : { 1, 10 }) {
+    RoundRobinScheduler scheduler(timeslice, threads);
+    for (size_t i = 0; i < threads; ++i) {
+      scheduler.new_thread(static_cast<int>(i));
+    }
+    Stopwatch sw;
+    for (uint64_t i = 0; i < sample; ++i) {
+      scheduler.timer_tick();
+    }
+    do_not_optimize(scheduler.current_thread());
+    double const per_tick = sw.seconds() / sample;
+    sw.restart();
+    scheduler.advance(horizon);
+    do_not_optimize(scheduler.current_thread());
+    double const advance_time = sw.seconds();
+    printf("  timeslice %2d: timer_tick() loop ~%.1f s (from %llu ticks), advance() %.1f us\n", timeslice,
+           per_tick * horizon, static_cast<unsigned long long>(sample), advance_time * 1e6);
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Command line of a benchmark: "--key=value" options, everything else is a positional argument
+class BenchArgs {
+public:
+  BenchArgs(int argc, char** argv) {
+    for (int i = 0; i < argc; ++i) {
+      if (std::strncmp(argv[i], "--", 2) == 0) {
+        m_options.emplace_back(argv[i] + 2);
+      } else {
+        m_positional.emplace_back(argv[i]);
+      }
+    }
+  }
+
+  uint64_t get_u64(char const* key, uint64_t default_value) const {
+    std::string const* value = find(key);
+    return value ? std::strtoull(value->c_str(), nullptr, 0) : default_value;
+  }
+
+  double get_double(char const* key, double default_value) const {
+    std::string const* value = find(key);
+    return value ? std::strtod(value->c_str(), nullptr) : default_value;
+  }
+
+  std::string get_string(char const* key, std::string const& default_value) const {
+    std::string const* value = find(key);
+    return value ? *value : default_value;
+  }
+
+  std::vector<std::string> const& positional() const { return m_positional; }
+
+private:
+  std::string const* find(char const* key) const {
+    size_t const len = std::strlen(key);
+    for (auto const& option : m_options) {
+      if (option.compare(0, len, key) == 0 && option.size() > len && option[len] == '=') {
+        m_value = option.substr(len + 1);
+        return &m_value;
+      }
+    }
+    return nullptr;
+  }
+
+  std::vector<std::string> m_options;
+  std::vector<std::string> m_positional;
+  mutable std::string m_value;
+};
+
+class Stopwatch {
+public:
+  Stopwatch() : m_start(std::chrono::steady_clock::now()) {}
+
+  void restart() { m_start = std::chrono::steady_clock::now(); }
+
+  double seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point m_start;
+};
+
+// Keeps the compiler from throwing away the computation that produced 'value'
+template <typename T>
+inline void do_not_optimize(T const& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
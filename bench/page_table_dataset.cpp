@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <numeric>
+#include <random>
+
+#include "../include/fast_io.h"
+#include "../include/mapping.h"
+#include "page_table_dataset.h"
+
+namespace {
+  double uniform(std::mt19937_64& rng) {
+    return (rng() >> 11) * (1.0 / 9007199254740992.0);
+  }
+}
+
+PageTableDump generate_dump(DumpShape const& shape) {
+  std::mt19937_64 rng(shape.seed);
+  PageTableDump dump;
+  dump.entries.reserve(shape.entry_count);
+
+  uint64_t next_frame = 0x100;
+  auto new_frame = [&]() {
+    next_frame += 1 + rng() % 8;
+    return next_frame;
+  };
+
+  size_t const depth = shape.la57 ? 5 : 4;
+  AddressPart const* levels = shape.la57 ? PAGE_LEVELS_LA57 : PAGE_LEVELS;
+  uint64_t const address_mask = mask(12, levels[0].shift + 8);
+
+  uint64_t const leaf_fill = std::max<uint64_t>(1, std::min<uint64_t>(shape.leaf_fill, PhysicalMemory::ENTRIES_PER_FRAME));
+  uint64_t fanout = 1;
+  for (; fanout < PhysicalMemory::ENTRIES_PER_FRAME; ++fanout) {
+    uint64_t total = 0, tables = 1;
+    for (size_t level = 0; level + 1 < depth; ++level) {
+      tables *= fanout;
+      total += tables;
+    }
+    if (total + tables * leaf_fill >= shape.entry_count) {
+      break;
+    }
+  }
+
+  uint64_t const root = new_frame();
+  dump.root_address = root << PhysicalMemory::FRAME_SHIFT;
+
+  std::vector<uint64_t> tables { root };
+  std::vector<uint64_t> prefixes { 0 };  // logical address bits that lead to the table
+  std::vector<std::pair<uint64_t, uint64_t>> mapped_pages;  // logical address of the page and mask of its offset
+  std::vector<uint64_t> data_frames;                        // frames of 4 KiB pages, kept only to make aliases
+  std::array<uint64_t, PhysicalMemory::ENTRIES_PER_FRAME> slots {};
+  std::iota(slots.begin(), slots.end(), 0);
+
+  for (size_t level = 0; level < depth && dump.entries.size() < shape.entry_count; ++level) {
+    std::vector<uint64_t> next_tables, next_prefixes;
+    size_t const levels_below = depth - 1 - level;
+    uint64_t const count = levels_below ? fanout : leaf_fill;
+
+    for (size_t i = 0; i < tables.size() && dump.entries.size() < shape.entry_count; ++i) {
+      for (uint64_t k = 0; k < count; ++k) {
+        std::swap(slots[k], slots[k + rng() % (slots.size() - k)]);
+      }
+      for (uint64_t k = 0; k < count && dump.entries.size() < shape.entry_count; ++k) {
+        uint64_t const ph_addr = (tables[i] << PhysicalMemory::FRAME_SHIFT) + slots[k] * 8;
+        uint64_t const prefix = prefixes[i] | (slots[k] << levels[level].shift);
+
+        if (rng() % 20 == 0) {
+          // Not present entry: P and R/W bits are clear, the rest is garbage
+          dump.entries.emplace_back(ph_addr, (rng() & PHYSICAL_ADDRESS_MASK.mask) | (rng() & 0x60));
+          continue;
+        }
+
+        if ((levels_below == 1 || levels_below == 2) && shape.large_page_ratio > 0 &&
+            uniform(rng) < shape.large_page_ratio) {
+          // 2 MiB or 1 GiB page: the frame is aligned to the page size, PS is set
+          uint64_t const frames_per_page = 1ULL << (levels[level].shift - PhysicalMemory::FRAME_SHIFT);
+          next_frame = (next_frame / frames_per_page + 1) * frames_per_page;
+          dump.entries.emplace_back(ph_addr, (next_frame << PhysicalMemory::FRAME_SHIFT) | 0x81 | (rng() & 0x66));
+          next_frame += frames_per_page;
+          mapped_pages.emplace_back(prefix, (1ULL << levels[level].shift) - 1);
+          continue;
+        }
+
+        uint64_t child = 0;
+        if (!levels_below && shape.alias_ratio > 0 && !data_frames.empty() && uniform(rng) < shape.alias_ratio) {
+          child = data_frames[rng() % data_frames.size()];
+        } else {
+          child = new_frame();
+          if (!levels_below && shape.alias_ratio > 0) {
+            data_frames.push_back(child);
+          }
+        }
+        dump.entries.emplace_back(ph_addr, (child << PhysicalMemory::FRAME_SHIFT) | 1 | (rng() & 0x66));
+        if (levels_below) {
+          next_tables.push_back(child);
+          next_prefixes.push_back(prefix);
+        } else {
+          mapped_pages.emplace_back(prefix, OFFSET_MASK.mask);
+        }
+      }
+    }
+    tables.swap(next_tables);
+    prefixes.swap(next_prefixes);
+  }
+  std::shuffle(dump.entries.begin(), dump.entries.end(), rng);
+
+  dump.queries.reserve(shape.query_count);
+  uint64_t previous = 0;
+  for (size_t i = 0; i < shape.query_count; ++i) {
+    uint64_t page = 0;
+    if (i > 0 && uniform(rng) < shape.locality) {
+      page = (previous & ~OFFSET_MASK.mask) + (rng() % 4 == 0 ? (1ULL << TABLE_MASK.shift) : 0);
+    } else if (!mapped_pages.empty() && uniform(rng) < shape.mapped_ratio) {
+      auto const& mapped = mapped_pages[rng() % mapped_pages.size()];
+      page = mapped.first;
+      if (mapped.second != OFFSET_MASK.mask) {
+        page |= rng() & mapped.second;
+      }
+    } else {
+      page = rng() & address_mask;
+    }
+    previous = (page & address_mask) | (rng() & OFFSET_MASK.mask);
+    dump.queries.push_back(previous);
+  }
+  return dump;
+}
+
+bool write_dump(PageTableDump const& dump, char const* path) {
+  FILE* file = std::fopen(path, "w");
+  if (!file) {
+    return false;
+  }
+  std::fprintf(file, "%zu %zu %" PRIu64 "\n", dump.entries.size(), dump.queries.size(), dump.root_address);
+  for (auto const& entry : dump.entries) {
+    std::fprintf(file, "%" PRIu64 " %" PRIu64 "\n", entry.first, entry.second);
+  }
+  for (uint64_t query : dump.queries) {
+    std::fprintf(file, "%" PRIu64 "\n", query);
+  }
+  return std::fclose(file) == 0;
+}
+
+bool read_dump(char const* path, PageTableDump& dump) {
+  MappedFile in;
+  if (!in.open(path)) {
+    return false;
+  }
+  NumberParser parser(in.data(), in.data() + in.size());
+  uint64_t table_size = 0, query_count = 0;
+  if (!parser.next(table_size) || !parser.next(query_count) || !parser.next(dump.root_address)) {
+    return false;
+  }
+
+  dump.entries.resize(table_size);
+  for (auto& entry : dump.entries) {
+    if (!parser.next(entry.first) || !parser.next(entry.second)) {
+      return false;
+    }
+  }
+  dump.queries.resize(query_count);
+  return parser.next(dump.queries.data(), query_count) == query_count;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Synthetic page-table dumps in the shape of the course dataset (dataset_44327_15.txt):
+//   "table_size query_count root_address", table_size lines "ph_addr value", query_count logical addresses.
+
+struct DumpShape {
+  size_t entry_count = 50000;
+  size_t query_count = 436000;
+  uint32_t leaf_fill = 8;        // present entries in every last level table, the upper levels are sized to fit
+  double mapped_ratio = 0.35;    // share of queries that hit a mapped page, the others are random addresses
+  double locality = 0.0;         // probability that a query stays in or next to the page of the previous query
+  double large_page_ratio = 0.0; // share of DirectoryPtr/Directory entries that map 1 GiB/2 MiB pages
+  bool la57 = false;             // 5-level page table
+  double alias_ratio = 0.0;      // share of 4 KiB pages that map a frame already mapped by another page
+  uint64_t seed = 44327;
+};
+
+struct PageTableDump {
+  uint64_t root_address = 0;
+  std::vector<std::pair<uint64_t, uint64_t>> entries;
+  std::vector<uint64_t> queries;
+};
+
+PageTableDump generate_dump(DumpShape const& shape);
+
+// Writes the dump in the text format read by testMapping()
+bool write_dump(PageTableDump const& dump, char const* path);
+
+// Reads a dump in the text format, returns false if the file can't be opened or is truncated
+bool read_dump(char const* path, PageTableDump& dump);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+#include "mapping.h"
+
+// Batched translation of large query streams.
+// Queries are processed in blocks: the page numbers are extracted with SIMD, the block is radix-sorted by page number,
+// so queries that share PLM4/DirectoryPtr/Directory prefixes become neighbours, and the walk reuses the upper-level
+// entries of the previous query instead of reading them again.
+
+// Writes the physical address or TRANSLATION_FAULT of logical[i] to physical[i], the arrays must not overlap
+void translate_batch(PhysicalMemory const& memory, uint64_t root_address,
+                     uint64_t const* logical, size_t count, uint64_t* physical);
+
+// Writes the result of one translation the way testMapping() prints it: "fault\n" or the decimal address and "\n".
+// 'dst' needs MAX_FORMATTED_TRANSLATION bytes, returns the number of bytes written.
+static constexpr size_t MAX_FORMATTED_TRANSLATION = 21;
+size_t format_translation(uint64_t physical, char* dst);
+
+// Appends the results of translate_batch to 'out'
+void format_translations(uint64_t const* physical, size_t count, std::string& out);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// XXH64 of a byte range: four multiply-rotate lanes and a final avalanche, so every input bit reaches every
+// output bit. For telling file contents apart, not for security.
+std::uint64_t content_hash(void const* data, size_t size, std::uint64_t seed = 0);
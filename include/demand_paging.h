@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "mapping.h"
+
+// Demand-paging simulator: a 4-level page table in the x86 format that is filled on faults from a bounded pool of
+// frames. Data frames take physical frames 0..frame_count-1, page-table pages are numbered after them.
+
+// Page-table pages, 512 entries each, carved out of large zeroed chunks.
+// Pages never move, so pointers to their entries stay valid until reset().
+class PageTableArena {
+public:
+  static constexpr size_t PAGES_PER_CHUNK = 512;  // 2 MiB chunks
+
+  // Returns the number of a zeroed page
+  uint32_t allocate();
+  uint64_t* page(uint32_t number) const {
+    return m_chunks[number / PAGES_PER_CHUNK].get() + (number % PAGES_PER_CHUNK) * PhysicalMemory::ENTRIES_PER_FRAME;
+  }
+
+  // Frees every page but keeps the chunks for the next address space
+  void reset();
+
+  size_t page_count() const { return m_used; }
+  // Bytes reserved by the chunks
+  size_t memory_usage() const { return m_chunks.size() * PAGES_PER_CHUNK * PhysicalMemory::ENTRIES_PER_FRAME * 8; }
+
+private:
+  std::vector<std::unique_ptr<uint64_t[]>> m_chunks;
+  size_t m_used = 0;
+  size_t m_dirty = 0;  // pages handed out since the chunks were allocated, they are zeroed again on reuse
+};
+
+enum class EvictionPolicy {
+  FIFO,
+  LRU,
+  CLOCK,
+  ARC,  // adaptive replacement cache: recency and frequency lists tuned by ghost hits
+};
+
+char const* eviction_policy_name(EvictionPolicy policy);
+
+// Decides which frame gives up its page when the pool is full.
+// Frames are numbered 0..frame_count-1 and filled in order before the first eviction.
+class ReplacementPolicy {
+public:
+  virtual ~ReplacementPolicy() = default;
+
+  // The page in 'frame' was accessed
+  virtual void on_hit(uint32_t frame) = 0;
+  // 'page' missed and every frame is in use, returns the frame to take from its current page
+  virtual uint32_t victim(uint64_t page) = 0;
+  // 'page' was loaded into 'frame'
+  virtual void on_load(uint32_t frame, uint64_t page) = 0;
+};
+
+// 'frame_count' 0 is taken as 1
+std::unique_ptr<ReplacementPolicy> make_replacement_policy(EvictionPolicy policy, size_t frame_count);
+
+struct PagingSimConfig {
+  size_t frame_count = 1024;  // 0 is taken as 1
+  EvictionPolicy policy = EvictionPolicy::LRU;
+  // Cost model of an access, in cycles
+  uint64_t entry_read_cost = 100;    // every page-table entry read by the walk
+  uint64_t fault_cost = 10000;       // handler entry and exit
+  uint64_t page_in_cost = 100000;    // reading the page back from the backing store
+};
+
+struct PagingSimStats {
+  uint64_t accesses = 0;
+  uint64_t faults = 0;
+  uint64_t cold_faults = 0;   // first touch of a page, zero-filled without a page-in
+  uint64_t evictions = 0;
+  uint64_t entries_read = 0;
+  uint64_t tables_allocated = 0;
+  uint64_t cycles = 0;
+};
+
+void print_paging_sim_stats(PagingSimStats const& stats, FILE* out);
+
+class DemandPagingSimulator {
+public:
+  explicit DemandPagingSimulator(PagingSimConfig const& config = PagingSimConfig());
+
+  // Translates 'logical_addr', handling the fault if the page is not present. Returns the physical address.
+  uint64_t access(uint64_t logical_addr);
+
+  // Drops every mapping, the frame pool and the replacement state, keeps the arena chunks
+  void reset();
+
+  PagingSimStats const& stats() const { return m_stats; }
+  PageTableArena const& arena() const { return m_arena; }
+  size_t resident_pages() const { return m_used_frames; }
+
+private:
+  // Walks to the leaf entry of 'logical_addr', allocating the missing tables
+  uint64_t* leaf_entry(uint64_t logical_addr);
+
+  PagingSimConfig const m_config;
+  PageTableArena m_arena;
+  std::unique_ptr<ReplacementPolicy> m_policy;
+  uint32_t m_root = 0;
+
+  // Leaf entry that maps every used frame
+  std::vector<uint64_t*> m_frame_entry;
+  size_t m_used_frames = 0;
+  PagingSimStats m_stats;
+};
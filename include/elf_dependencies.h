@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "elf_image.h"
+
+// Shared-library dependency graph from PT_DYNAMIC (DT_NEEDED, DT_RPATH, DT_RUNPATH), resolved with the search
+// rules of the dynamic loader but without running it. /etc/ld.so.cache is not read, its role is played by
+// DependencyOptions::default_paths.
+
+// What a resolution needs to know about one ELF file
+struct LibraryInfo {
+  std::string path;             // the path it was first opened by
+  char const* error = nullptr;  // why it couldn't be parsed, nullptr if it was
+  std::uint16_t machine = 0;
+  std::string soname;
+  std::vector<std::string> needed;
+  std::vector<std::string> rpath;    // DT_RPATH split at ':', $ORIGIN is not expanded yet
+  std::vector<std::string> runpath;  // DT_RUNPATH, likewise
+  std::uint64_t mapped_bytes = 0;    // page-accurate, see compute_load_footprint()
+};
+
+// Parsed libraries keyed by the file and its content: device, inode, size and a 64-bit content_hash(), so a
+// library reached through different paths or symlinks is parsed once and a file rewritten in place is parsed
+// again. Hashing every lookup would read libc for each binary, so the hash is remembered per file identity
+// (device, inode, size, mtime and ctime) and reused while that identity is unchanged. A write within the
+// timestamp granularity of the file system keeps the identity, so the remembered hash is trusted only for files
+// whose ctime is at least RACY_SECONDS older than the moment it was computed, younger files are hashed again.
+// Safe to share between threads.
+class LibraryCache {
+public:
+  static constexpr std::int64_t RACY_SECONDS = 2;
+
+  // Returns nullptr if the file doesn't exist
+  std::shared_ptr<LibraryInfo const> get(std::string const& path);
+
+  std::uint64_t hits() const;
+  std::uint64_t parses() const;
+  // Files read to compute their hash
+  std::uint64_t hashes() const;
+  size_t size() const;
+
+private:
+  using Identity = std::tuple<std::uint64_t, std::uint64_t, std::uint64_t, std::int64_t, std::int64_t,
+                              std::int64_t, std::int64_t>;
+  using Content = std::tuple<std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t>;  // dev, ino, size, hash
+
+  struct KnownHash {
+    Content content;
+    std::int64_t hashed_at;  // seconds since the epoch
+  };
+
+  mutable std::mutex m_mutex;
+  std::map<Identity, KnownHash> m_hashes;
+  std::map<Content, std::shared_ptr<LibraryInfo const>> m_libraries;
+  std::uint64_t m_hits = 0;
+  std::uint64_t m_parses = 0;
+  std::uint64_t m_hash_count = 0;
+};
+
+struct DependencyOptions {
+  std::vector<std::string> library_path;  // LD_LIBRARY_PATH, searched after DT_RPATH and before DT_RUNPATH
+  std::vector<std::string> default_paths = { "/lib/x86_64-linux-gnu", "/usr/lib/x86_64-linux-gnu", "/lib64",
+                                             "/usr/lib64", "/lib", "/usr/lib" };
+};
+
+struct DependencyNode {
+  std::string path;  // where it was found
+  std::shared_ptr<LibraryInfo const> info;
+  std::vector<size_t> needed;  // indexes of the nodes this one needs
+};
+
+struct DependencyGraph {
+  std::vector<DependencyNode> nodes;  // breadth-first load order, the binary itself first
+  std::vector<std::string> missing;   // DT_NEEDED names that could not be found
+  std::uint64_t mapped_bytes = 0;     // sum over the nodes
+};
+
+// Returns false if the binary itself can't be parsed. Missing libraries don't fail the resolution.
+bool resolve_dependencies(char const* path, LibraryCache& cache, DependencyGraph& graph,
+                          DependencyOptions const& options = DependencyOptions());
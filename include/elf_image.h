@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fast_io.h"
+
+#define ELF_NIDENT	16
+
+// Indexes and values of e_ident
+#define EI_CLASS	4
+#define EI_DATA		5
+#define ELFCLASS64	2
+#define ELFDATA2LSB	1
+
+// Program headers with type PT_LOAD must be loaded into the application memory during its loading
+#define PT_LOAD		1
+
+// Dynamic section: PT_DYNAMIC segment of elf_dyn entries, DT_NULL terminates it
+#define PT_DYNAMIC	2
+#define DT_NULL		0
+#define DT_NEEDED	1
+#define DT_STRTAB	5
+#define DT_STRSZ	10
+#define DT_SONAME	14
+#define DT_RPATH	15
+#define DT_RUNPATH	29
+
+// Segment permissions, p_flags
+#define PF_X		1
+#define PF_W		2
+#define PF_R		4
+
+// Section types
+#define SHT_SYMTAB	2
+#define SHT_STRTAB	3
+#define SHT_NOBITS	8
+#define SHT_DYNSYM	11
+#define SHT_GNU_HASH	0x6ffffff6
+
+// Symbol types and bindings, st_info holds the binding in the high nibble
+#define STT_OBJECT	1
+#define STT_FUNC	2
+#define STB_GLOBAL	1
+#define STB_WEAK	2
+#define SHN_UNDEF	0
+
+// ELF header
+struct elf_hdr {
+  std::uint8_t e_ident[ELF_NIDENT];
+  std::uint16_t e_type;
+  std::uint16_t e_machine;
+  std::uint32_t e_version;
+  std::uint64_t e_entry;
+  std::uint64_t e_phoff;
+  std::uint64_t e_shoff;
+  std::uint32_t e_flags;
+  std::uint16_t e_ehsize;
+  std::uint16_t e_phentsize;
+  std::uint16_t e_phnum;
+  std::uint16_t e_shentsize;
+  std::uint16_t e_shnum;
+  std::uint16_t e_shstrndx;
+} __attribute__((packed));
+
+// ELF program header entry
+struct elf_phdr {
+  std::uint32_t p_type;
+  std::uint32_t p_flags;
+  std::uint64_t p_offset;
+  std::uint64_t p_vaddr;
+  std::uint64_t p_paddr;
+  std::uint64_t p_filesz;
+  std::uint64_t p_memsz;
+  std::uint64_t p_align;
+} __attribute__((packed));
+
+// ELF section header entry
+struct elf_shdr {
+  std::uint32_t sh_name;
+  std::uint32_t sh_type;
+  std::uint64_t sh_flags;
+  std::uint64_t sh_addr;
+  std::uint64_t sh_offset;
+  std::uint64_t sh_size;
+  std::uint32_t sh_link;
+  std::uint32_t sh_info;
+  std::uint64_t sh_addralign;
+  std::uint64_t sh_entsize;
+} __attribute__((packed));
+
+// ELF symbol table entry
+struct elf_sym {
+  std::uint32_t st_name;
+  std::uint8_t st_info;
+  std::uint8_t st_other;
+  std::uint16_t st_shndx;
+  std::uint64_t st_value;
+  std::uint64_t st_size;
+} __attribute__((packed));
+
+// Checks the magic, the class and the bounds of the header tables of a file of 'file_size' bytes.
+// Returns nullptr for a valid header, otherwise what is wrong with it.
+char const* check_elf_header(elf_hdr const& hdr, std::uint64_t file_size);
+
+// ELF dynamic section entry
+struct elf_dyn {
+  std::int64_t d_tag;
+  std::uint64_t d_val;
+} __attribute__((packed));
+
+// A 64-bit little-endian ELF file mapped read-only. open() validates the magic and the bounds of the
+// program and section header tables once, the accessors then point into the mapping without copying.
+// Only the pages that are actually read are loaded, so a large binary costs a couple of page faults.
+// The accessors may be used only after a successful open().
+class ElfImage {
+public:
+  bool open(char const* path);
+  void close();
+
+  elf_hdr const& header() const { return *reinterpret_cast<elf_hdr const*>(m_file.data()); }
+  std::uint64_t entry_point() const { return header().e_entry; }
+
+  std::size_t segment_count() const { return header().e_phnum; }
+  elf_phdr const& segment(std::size_t idx) const {
+    return *reinterpret_cast<elf_phdr const*>(m_file.data() + header().e_phoff + idx * header().e_phentsize);
+  }
+
+  // Sum of p_memsz of the PT_LOAD segments
+  std::uint64_t load_size() const;
+  // File content at virtual address 'vaddr' if [vaddr, vaddr + size) is backed by one PT_LOAD segment, else nullptr
+  char const* at_address(std::uint64_t vaddr, std::uint64_t size) const;
+
+  std::size_t section_count() const { return m_section_count; }
+  elf_shdr const& section(std::size_t idx) const {
+    return *reinterpret_cast<elf_shdr const*>(m_file.data() + header().e_shoff + idx * header().e_shentsize);
+  }
+  // Content of a section, nullptr for SHT_NOBITS and for sections that don't fit in the file
+  char const* section_data(elf_shdr const& shdr) const;
+  // Name from the section header string table, "" if it is missing or out of bounds
+  char const* section_name(std::size_t idx) const;
+  // First section of the given type, nullptr if there is none
+  elf_shdr const* find_section(std::uint32_t type) const;
+
+  char const* data() const { return m_file.data(); }
+  std::size_t size() const { return m_file.size(); }
+  // Why the last open failed
+  char const* error() const { return m_error; }
+
+private:
+  bool fail(char const* error);
+
+  MappedFile m_file;
+  std::size_t m_section_count = 0;
+  char const* m_error = "";
+};
+
+// Return 0 if the file can't be opened or is not a valid ELF file
+std::uintptr_t entry_point(const char *name);
+std::size_t space(const char *name);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "elf_image.h"
+
+// Load footprint of the PT_LOAD segments as the dynamic loader maps them: every segment covers whole pages,
+// the file-backed part ends at the page holding the last file byte, the rest of p_memsz (BSS) is anonymous.
+
+struct SegmentLayout {
+  elf_phdr phdr;
+  std::uint64_t page_start = 0;  // first byte of the first page
+  std::uint64_t page_end = 0;    // end of the last page
+  std::uint64_t file_pages = 0;  // pages mapped from the file, the last one may have a zeroed tail
+  std::uint64_t bss_pages = 0;   // anonymous zero pages after them
+  std::uint64_t bss_bytes = 0;   // p_memsz - p_filesz
+};
+
+struct LoadFootprint {
+  std::uint64_t page_size = 0;
+  std::uint64_t align = 0;         // largest p_align, the alignment of the reservation
+  std::uint64_t span_start = 0;    // page-aligned virtual span of all segments
+  std::uint64_t span_end = 0;
+  std::uint64_t span_pages = 0;
+  std::uint64_t mapped_pages = 0;  // union of the segment pages, a page shared by two segments counts once
+  std::uint64_t overlap_pages = 0; // distinct pages claimed by more than one segment
+  std::uint64_t gap_pages = 0;     // holes inside the span that stay reserved but unmapped
+  std::uint64_t file_pages = 0;
+  std::uint64_t bss_pages = 0;
+  std::uint64_t naive_size = 0;    // sum of p_memsz, what space() reports
+  std::vector<SegmentLayout> segments;
+};
+
+// 'page_size' 0 means the page size of the host
+LoadFootprint compute_load_footprint(std::vector<elf_phdr> const& loads, std::uint64_t page_size = 0);
+LoadFootprint compute_load_footprint(ElfImage const& image, std::uint64_t page_size = 0);
+
+// "rwx"-style permissions of a segment
+void segment_permissions(std::uint32_t flags, char out[4]);
+
+// Maps the segments of a binary like the dynamic loader does, without running or relocating it:
+// one PROT_NONE reservation aligned to the largest p_align, file-backed private mappings at their page
+// offsets with the segment permissions, and anonymous pages for BSS. Everything is lazy until touched.
+// The image is always placed at an address chosen by the kernel, even for ET_EXEC.
+class SegmentLoader {
+public:
+  SegmentLoader() = default;
+  ~SegmentLoader();
+  SegmentLoader(SegmentLoader const&) = delete;
+  SegmentLoader& operator=(SegmentLoader const&) = delete;
+
+  bool load(char const* path);
+  void unload();
+
+  // Reads one byte of every mapped page, returns the number of pages touched
+  std::uint64_t touch() const;
+
+  char const* base() const { return m_base; }
+  // Load bias: base address minus the lowest p_vaddr, rounded down to a page
+  std::uint64_t bias() const { return m_bias; }
+  LoadFootprint const& footprint() const { return m_footprint; }
+  char const* error() const { return m_error; }
+
+private:
+  bool fail(char const* error);
+
+  char* m_reservation = nullptr;
+  std::uint64_t m_reservation_size = 0;
+  char* m_base = nullptr;
+  std::uint64_t m_bias = 0;
+  LoadFootprint m_footprint;
+  char const* m_error = "";
+};
+
+// Resident set size of this process in bytes, 0 if it can't be read
+std::uint64_t process_rss();
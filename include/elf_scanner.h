@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "elf_image.h"
+
+// Bulk scan of a directory tree: the calling thread walks the tree, a pool of workers reads the ELF header and
+// the program header table of every regular file with two bounded preads, so a file costs the same I/O whatever
+// its size. Symbolic links are not followed.
+
+struct ElfScanResult {
+  std::string path;
+  std::uint64_t file_size = 0;
+  std::uint16_t type = 0;
+  std::uint16_t machine = 0;
+  std::uint64_t entry = 0;
+  std::uint64_t load_size = 0;   // sum of p_memsz of the PT_LOAD segments, like space()
+  std::vector<elf_phdr> loads;   // PT_LOAD segments in file order
+};
+
+struct ElfScanOptions {
+  size_t workers = 0;        // 0 means std::thread::hardware_concurrency()
+  size_t max_in_flight = 0;  // paths found but not scanned yet; 0 means 256 per worker
+};
+
+struct ElfScanStats {
+  std::uint64_t files = 0;       // regular files seen
+  std::uint64_t elf_files = 0;
+  std::uint64_t errors = 0;      // unreadable files and ELF files with broken headers
+  std::uint64_t bytes_read = 0;
+  double seconds = 0;
+};
+
+// Called for every valid ELF file, from the workers but never concurrently, in no particular order
+using ElfScanSink = std::function<void(ElfScanResult const& result)>;
+
+ElfScanStats scan_elf_tree(char const* root, ElfScanSink const& sink,
+                           ElfScanOptions const& options = ElfScanOptions());
+
+enum class ElfScanFormat {
+  CSV,
+  JSON,  // one object per line
+};
+
+// Header line of the CSV output, empty for JSON
+char const* elf_scan_header(ElfScanFormat format);
+// Appends one line describing 'result'
+void format_elf_scan_result(ElfScanResult const& result, ElfScanFormat format, std::string& out);
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Input and output paths for big dumps without locale-aware stream operations
+
+// Read-only view of a whole file: mmap on UNIX, a single read into memory elsewhere
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  bool open(char const* path);
+  void close();
+
+  char const* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  char const* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_mapped = false;
+  std::vector<char> m_buffer;  // the file content when it can't be mapped
+};
+
+// Parses unsigned decimal numbers separated by anything else (whitespace in our dumps).
+// Runs of 8 digits are converted at once with SWAR arithmetic, numbers longer than 20 digits wrap around.
+class NumberParser {
+public:
+  NumberParser(char const* begin, char const* end) : m_pos(begin), m_end(end) {}
+
+  // Returns false if there are no more numbers
+  bool next(uint64_t& value) {
+    while (m_pos != m_end && !is_digit(*m_pos)) {
+      ++m_pos;
+    }
+    if (m_pos == m_end) {
+      return false;
+    }
+
+    uint64_t res = 0;
+    uint64_t chunk = 0;
+    while (m_end - m_pos >= 8 && eight_digits(m_pos, chunk)) {
+      res = res * 100000000 + chunk;
+      m_pos += 8;
+    }
+    while (m_pos != m_end && is_digit(*m_pos)) {
+      res = res * 10 + static_cast<uint64_t>(*m_pos - '0');
+      ++m_pos;
+    }
+    value = res;
+    return true;
+  }
+
+  // Reads up to 'count' numbers, returns how many were read
+  size_t next(uint64_t* values, size_t const count) {
+    size_t i = 0;
+    while (i < count && next(values[i])) {
+      ++i;
+    }
+    return i;
+  }
+
+  char const* position() const { return m_pos; }
+
+private:
+  static bool is_digit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+  // Converts 8 ASCII digits, returns false if any of the bytes is not a digit
+  static bool eight_digits(char const* p, uint64_t& value) {
+    uint64_t x;
+    std::memcpy(&x, p, sizeof(x));
+    if ((((x & 0xF0F0F0F0F0F0F0F0ULL) | (((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) !=
+         0x3333333333333333ULL)) {
+      return false;
+    }
+    // Little endian: the first digit is the lowest byte
+    x -= 0x3030303030303030ULL;
+    x = (x * 10) + (x >> 8);
+    x = (((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    value = x;
+    return true;
+  }
+
+  char const* m_pos;
+  char const* m_end;
+};
+
+// Output buffer flushed to a file with a few large write calls
+class BufferedWriter {
+public:
+  explicit BufferedWriter(size_t capacity = 1 << 22) : m_buffer(capacity) {}
+  ~BufferedWriter();
+  BufferedWriter(BufferedWriter const&) = delete;
+  BufferedWriter& operator=(BufferedWriter const&) = delete;
+
+  bool open(char const* path);
+  // Flushes the buffer and closes the file, returns false if any write failed
+  bool close();
+  bool is_open() const { return m_fd >= 0; }
+
+  void write(char const* data, size_t size) {
+    if (m_size + size > m_buffer.size()) {
+      flush();
+      if (size >= m_buffer.size()) {
+        write_out(data, size);
+        return;
+      }
+    }
+    std::memcpy(m_buffer.data() + m_size, data, size);
+    m_size += size;
+  }
+
+  // Returns room for at least 'size' bytes, 'commit' the bytes actually written there
+  char* reserve(size_t size) {
+    if (m_size + size > m_buffer.size()) {
+      flush();
+      if (size > m_buffer.size()) {
+        m_buffer.resize(size);
+      }
+    }
+    return m_buffer.data() + m_size;
+  }
+
+  void commit(size_t size) { m_size += size; }
+
+  void flush();
+
+private:
+  void write_out(char const* data, size_t size);
+
+  std::vector<char> m_buffer;
+  size_t m_size = 0;
+  int m_fd = -1;
+  bool m_failed = false;
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+// Mapping logical address to the physical address for x86 arch
+
+// Paging: Logical address in x86 (Long Mode)
+// 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000
+//    |    |    |    |    |    |    |    |    |    |    |    |    |    |    |    |
+//   60   56   52   48   44   40   36   32   28   24   20   16   12    8    4    0
+// |                   |  PLM4   |  DirPtr   | Directory |  Table  |    Offset    |
+// |    [63:48] = 47   | 47 - 39 |  38 - 30  |  29 - 21  | 20 - 12 |    12 - 0    |
+//
+// 5-level paging (LA57) adds PLM5 in bits 56:48 above PLM4.
+// An entry with the PS bit (7) set at DirectoryPtr maps a 1 GiB page, at Directory - a 2 MiB page,
+// the rest of the logical address is the offset inside the page.
+
+static constexpr uint64_t mask(size_t from, size_t to) {
+  uint64_t res = 0;
+  for (size_t i = from; i <= to; ++i) {
+    res |= (1ULL << i);
+  }
+  return res;
+}
+
+struct AddressPart {
+  uint64_t const mask;
+  uint64_t const shift;
+
+  constexpr AddressPart(uint64_t const mask, uint64_t const shift) : mask(mask), shift(shift) {}
+};
+
+static constexpr AddressPart const PLM5_MASK { mask(48, 56), 48 };
+static constexpr AddressPart const PLM4_MASK { mask(39, 47), 39 };
+static constexpr AddressPart const DIRECTORY_PTR_MASK { mask(30, 38), 30 };
+static constexpr AddressPart const DIRECTORY_MASK { mask(21, 29), 21 };
+static constexpr AddressPart const TABLE_MASK { mask(12, 20), 12 };
+static constexpr AddressPart const OFFSET_MASK { mask(0, 11), 0 };
+static constexpr AddressPart const PHYSICAL_ADDRESS_MASK { mask(12, 51), 0 };
+static constexpr AddressPart const LAST_BIT_MASK { mask(0, 1), 0 };
+static constexpr AddressPart const VIRTUAL_PAGE_MASK { mask(12, 47), 12 };
+static constexpr AddressPart const PRESENT_BIT_MASK { mask(0, 0), 0 };
+static constexpr AddressPart const PAGE_SIZE_BIT_MASK { mask(7, 7), 7 };
+
+// Index parts of the logical address in the order the walker uses them
+static constexpr AddressPart const PAGE_LEVELS[] = { PLM4_MASK, DIRECTORY_PTR_MASK, DIRECTORY_MASK, TABLE_MASK };
+static constexpr AddressPart const PAGE_LEVELS_LA57[] = { PLM5_MASK, PLM4_MASK, DIRECTORY_PTR_MASK, DIRECTORY_MASK, TABLE_MASK };
+static constexpr size_t MAX_PAGE_LEVELS = 5;
+
+// Physical addresses are at most 52 bits wide, so this value never collides with a real translation
+static constexpr uint64_t TRANSLATION_FAULT = ~0ULL;
+
+inline uint64_t part_of_logical_address(uint64_t logical_addr, AddressPart part) {
+  return (logical_addr & part.mask) >> part.shift;
+}
+
+// Physical memory image of a page-table dump.
+// Every 4 KiB frame that holds at least one entry is stored as a dense table of 512 entries,
+// frames are sorted by number and found through an open-addressing index keyed by frame number.
+// So a load costs one frame lookup (usually a single probe) plus an indexed load inside the frame.
+// The image either owns its arrays (build) or views arrays owned by someone else, e.g. a mapped snapshot (attach).
+class PhysicalMemory {
+public:
+  static constexpr uint64_t FRAME_SHIFT = 12;
+  static constexpr uint64_t ENTRIES_PER_FRAME = 512;
+  static constexpr uint32_t EMPTY_SLOT = ~0U;
+
+  PhysicalMemory() = default;
+  PhysicalMemory(PhysicalMemory const&) = delete;
+  PhysicalMemory& operator=(PhysicalMemory const&) = delete;
+
+  // Builds the image from (ph_addr, value) pairs, later pairs win over earlier ones with the same address.
+  // Entries that are not 8-byte aligned can't be reached by the walker and are dropped.
+  void build(std::vector<std::pair<uint64_t, uint64_t>> entries);
+
+  // Views arrays laid out like the ones build() makes, they must outlive the image.
+  // 'index_capacity' must be a power of two, at least 2 and greater than 'frame_count'.
+  void attach(uint64_t const* frames, size_t frame_count, uint64_t const* tables,
+              uint32_t const* index, size_t index_capacity);
+
+  // Returns the table stored in the frame or nullptr if the dump has no entries in it
+  uint64_t const* frame(uint64_t frame_number) const {
+    if (m_frame_count == 0) {
+      return nullptr;
+    }
+    for (uint64_t slot = hash(frame_number, m_hash_shift);; slot = (slot + 1) & m_index_mask) {
+      uint32_t const idx = m_index[slot];
+      if (idx == EMPTY_SLOT) {
+        return nullptr;
+      }
+      if (m_frames[idx] == frame_number) {
+        return &m_tables[idx * ENTRIES_PER_FRAME];
+      }
+    }
+  }
+
+  // Returns the 8-byte value at the physical address or 0 if there is no such entry
+  uint64_t load(uint64_t const ph_addr) const {
+    uint64_t const* table = frame(ph_addr >> FRAME_SHIFT);
+    return table ? table[(ph_addr & OFFSET_MASK.mask) >> 3] : 0;
+  }
+
+  size_t frame_count() const { return m_frame_count; }
+  size_t index_capacity() const { return m_frame_count ? m_index_mask + 1 : 0; }
+  uint64_t const* frames() const { return m_frames; }
+  uint64_t const* tables() const { return m_tables; }
+  uint32_t const* index() const { return m_index; }
+
+  size_t memory_usage() const {
+    return m_frame_count * (ENTRIES_PER_FRAME + 1) * sizeof(uint64_t) + index_capacity() * sizeof(uint32_t);
+  }
+
+private:
+  static uint64_t hash(uint64_t frame_number, uint32_t hash_shift) {
+    return (frame_number * 0x9E3779B97F4A7C15ULL) >> hash_shift;
+  }
+
+  uint64_t const* m_frames = nullptr;  // sorted frame numbers
+  uint64_t const* m_tables = nullptr;  // ENTRIES_PER_FRAME values for every frame in m_frames
+  uint32_t const* m_index = nullptr;   // open-addressing index: slot -> position in m_frames
+  size_t m_frame_count = 0;
+  uint64_t m_index_mask = 0;
+  uint32_t m_hash_shift = 63;
+
+  std::vector<uint64_t> m_frames_storage;
+  std::vector<uint64_t> m_tables_storage;
+  std::vector<uint32_t> m_index_storage;
+};
+
+// How the walker interprets the page table. The default is the course format: 4 levels, 4 KiB pages only,
+// an entry is present if any of bits 0..1 is set.
+struct PagingMode {
+  bool large_pages = false;       // honor PS at DirectoryPtr (1 GiB pages) and Directory (2 MiB pages)
+  bool la57 = false;              // 5-level paging
+  bool present_bit_only = false;  // an entry is present if P (bit 0) is set, like the hardware does
+
+  size_t depth() const { return la57 ? 5 : 4; }
+  AddressPart const* levels() const { return la57 ? PAGE_LEVELS_LA57 : PAGE_LEVELS; }
+};
+
+// Where walks ended: a walk that read d entries is counted in mapped[d] or faults[d]
+struct WalkStats {
+  uint64_t walks = 0;
+  uint64_t mapped[MAX_PAGE_LEVELS + 1] = {};
+  uint64_t faults[MAX_PAGE_LEVELS + 1] = {};
+};
+
+void print_walk_stats(WalkStats const& stats, FILE* out);
+
+// Reads the entry of the table selected by 'part' of the logical address.
+// Returns 0 if the entry is not present.
+template <typename Memory>
+uint64_t read_entry(uint64_t const table_base_address, uint64_t const logical_address, AddressPart const& part,
+                    Memory const& memory, AddressPart const& present = LAST_BIT_MASK)
+{
+  uint64_t table_idx        = part_of_logical_address(logical_address, part);
+  uint64_t table_ph_address = part_of_logical_address(table_base_address, PHYSICAL_ADDRESS_MASK);
+
+  auto next_table_base_address = memory.load(table_ph_address + table_idx * 8);
+  if (!part_of_logical_address(next_table_base_address, present)) { // check P bit
+    return 0;
+  }
+  return next_table_base_address;
+}
+
+// Walks the page table. Returns the physical address or TRANSLATION_FAULT.
+// 'Memory' provides 'uint64_t load(uint64_t ph_addr) const' returning 0 for missing entries.
+template <typename Memory>
+uint64_t map_addr(uint64_t const logical_addr, uint64_t table_base_address, Memory const& memory,
+                  PagingMode const& mode, WalkStats* stats = nullptr)
+{
+  size_t const depth = mode.depth();
+  AddressPart const* levels = mode.levels();
+  AddressPart const& present = mode.present_bit_only ? PRESENT_BIT_MASK : LAST_BIT_MASK;
+  if (stats) {
+    ++stats->walks;
+  }
+
+  for (size_t level = 0; level < depth; ++level) {
+    table_base_address = read_entry(table_base_address, logical_addr, levels[level], memory, present);
+    if (!table_base_address) {
+      if (stats) {
+        ++stats->faults[level + 1];
+      }
+      return TRANSLATION_FAULT;
+    }
+
+    // DirectoryPtr and Directory are the 3rd and 2nd levels from the bottom
+    size_t const levels_below = depth - 1 - level;
+    if (mode.large_pages && (levels_below == 1 || levels_below == 2) &&
+        part_of_logical_address(table_base_address, PAGE_SIZE_BIT_MASK)) {
+      if (stats) {
+        ++stats->mapped[level + 1];
+      }
+      uint64_t const offset_mask = (1ULL << levels[level].shift) - 1;
+      return (table_base_address & PHYSICAL_ADDRESS_MASK.mask & ~offset_mask) + (logical_addr & offset_mask);
+    }
+  }
+
+  if (stats) {
+    ++stats->mapped[depth];
+  }
+  return part_of_logical_address(table_base_address, PHYSICAL_ADDRESS_MASK) +
+         part_of_logical_address(logical_addr, OFFSET_MASK);
+}
+
+// Walks 4 levels of the page table in the course format
+template <typename Memory>
+uint64_t map_addr(uint64_t const logical_addr, uint64_t const table_base_address, Memory const& memory) {
+  return map_addr(logical_addr, table_base_address, memory, PagingMode());
+}
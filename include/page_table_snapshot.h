@@ -0,0 +1,58 @@
+#pragma once
+
+#include "fast_io.h"
+#include "mapping.h"
+
+// Binary snapshot of a PhysicalMemory image. The loader maps the file and the image views it in place,
+// so startup costs a header check instead of parsing the whole text dump.
+// Layout, little endian:
+//   SnapshotHeader
+//   frames: frame_count x uint64_t, sorted frame numbers
+//   index:  index_capacity x uint32_t, open-addressing index
+//   tables: frame_count x 512 x uint64_t, aligned to 4 KiB
+
+static constexpr char const SNAPSHOT_MAGIC[8] = { 'O', 'S', 'P', 'T', 'S', 'N', 'A', 'P' };
+static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t root_address;
+  uint64_t frame_count;
+  uint64_t index_capacity;
+  uint64_t frames_offset;
+  uint64_t index_offset;
+  uint64_t tables_offset;
+  uint64_t file_size;
+  uint64_t data_checksum;    // of everything after the header, checked only on request
+  uint64_t header_checksum;  // of the header bytes before this field
+};
+
+// FNV-1a over 64-bit words, the tail is zero-padded
+uint64_t snapshot_checksum(void const* data, size_t size);
+
+bool write_snapshot(PhysicalMemory const& memory, uint64_t root_address, char const* path);
+
+// Converts a dump in the dataset_44327_15.txt format, the queries are ignored
+bool convert_dump_to_snapshot(char const* dump_path, char const* snapshot_path);
+
+class PageTableSnapshot {
+public:
+  // Maps and validates the snapshot: magic, version, header checksum, bounds of every array and every index slot.
+  // 'verify_data' also checks the data checksum, which reads the whole file.
+  bool open(char const* path, bool verify_data = false);
+
+  PhysicalMemory const& memory() const { return m_memory; }
+  uint64_t root_address() const { return m_root_address; }
+  // Why the last open failed
+  char const* error() const { return m_error; }
+
+private:
+  bool fail(char const* error);
+
+  MappedFile m_file;
+  PhysicalMemory m_memory;
+  uint64_t m_root_address = 0;
+  char const* m_error = "";
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "mapping.h"
+
+// Reverse (physical -> logical) index over a loaded page table.
+// The first query walks the tree reachable from the root once, with the same masks as the walker, and keeps only
+// the present leaf entries: one sorted array per page size. A lookup is a binary search in each array.
+// A table reached through several parents is enumerated once, so the index stays bounded even for heavily shared
+// dumps: its leaves keep the logical bits below the table, and the table keeps every (parent, index) that reaches
+// it. Lookups expand those prefixes, so every alias a shared table creates is reported.
+// After the build the index is read-only and can be shared across threads.
+class ReverseMapping {
+public:
+  ReverseMapping(PhysicalMemory const& memory, uint64_t root_address, PagingMode const& mode = PagingMode());
+
+  // Appends the logical addresses that translate to 'physical', returns how many were found
+  size_t logical_addresses(uint64_t physical, std::vector<uint64_t>& out) const;
+
+  // Number of logical pages that map the 4 KiB frame containing 'physical'
+  size_t mapping_count(uint64_t physical) const;
+
+  // Physical addresses of the 4 KiB frames mapped by more than one logical page, sorted
+  std::vector<uint64_t> const& shared_frames() const;
+
+  // Logical pages, the aliases through shared tables included
+  size_t page_count() const;
+  // Times a table was reached again through another parent
+  size_t shared_tables() const;
+
+private:
+  struct Page {
+    uint64_t physical;  // page base address
+    uint32_t table;     // the table holding the leaf entry
+    uint64_t logical;   // logical bits selected within 'table', the prefixes of the table add the rest
+
+    bool operator<(Page const& other) const {
+      if (physical != other.physical) {
+        return physical < other.physical;
+      }
+      return table < other.table || (table == other.table && logical < other.logical);
+    }
+  };
+
+  // One entry of a parent table that points to a table
+  struct Parent {
+    uint32_t table;
+    uint64_t logical;  // logical bits selected within the parent
+  };
+
+  struct Table {
+    std::vector<Parent> parents;  // none for the root
+    uint64_t prefix_count = 0;    // logical prefixes that reach the table, 0 until counted
+  };
+
+  static constexpr uint32_t NOT_VISITED = ~uint32_t(0);
+
+  // 4 KiB, 2 MiB and 1 GiB pages
+  static constexpr size_t PAGE_SIZES = 3;
+  static constexpr uint64_t PAGE_SHIFTS[PAGE_SIZES] = { 12, 21, 30 };
+
+  void build() const;
+  void enumerate(uint64_t table_base_address, size_t level, Parent const& parent, std::vector<uint32_t>& visited) const;
+  uint64_t prefix_count(uint32_t table) const;
+  void expand(uint32_t table, uint64_t logical, std::vector<uint64_t>& out) const;
+  // Calls 'visit' for every page of the size that starts at 'base'
+  template <typename Visit>
+  void for_each_page(size_t size, uint64_t base, Visit const& visit) const;
+
+  PhysicalMemory const& m_memory;
+  uint64_t const m_root_address;
+  PagingMode const m_mode;
+
+  mutable std::once_flag m_built;
+  mutable std::once_flag m_shared_built;
+  mutable std::vector<Page> m_pages[PAGE_SIZES];
+  mutable std::vector<Table> m_tables;
+  mutable size_t m_page_count = 0;
+  mutable std::vector<uint64_t> m_shared_frames;
+  mutable size_t m_shared_tables = 0;
+};
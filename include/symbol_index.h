@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "elf_image.h"
+
+struct Symbol {
+  std::uint64_t address;
+  std::uint64_t size;
+  char const* name;  // points into the ElfImage
+  std::uint8_t type;
+  std::uint8_t binding;
+};
+
+// Name and address index over the defined symbols of .symtab and .dynsym.
+// Built once per binary, after that every method is const and allocation free, so one index can be shared
+// by any number of threads. The ElfImage must stay open while the index is used.
+class SymbolIndex {
+public:
+  // Returns false if the image has no symbol table, error() tells why
+  bool build(ElfImage const& image);
+
+  // Defined symbol with this name, .symtab is preferred to .dynsym. nullptr if there is none.
+  Symbol const* find(char const* name) const;
+
+  // Function or object whose [address, address + size) contains 'address', nullptr if there is none.
+  // A symbol of size 0 covers the addresses up to the next function or object.
+  Symbol const* symbolize(std::uint64_t address, std::uint64_t* offset = nullptr) const;
+
+  std::vector<Symbol> const& symbols() const { return m_symbols; }
+  size_t address_ranges() const { return m_starts.size(); }
+  // true if .dynsym names are looked up through the binary's own .gnu.hash
+  bool uses_gnu_hash() const { return m_gnu_buckets != nullptr; }
+  char const* error() const { return m_error; }
+
+  static std::uint32_t gnu_hash(char const* name);
+
+private:
+  static constexpr std::uint32_t NONE = ~0U;
+
+  struct Range {
+    std::uint64_t end;
+    std::uint32_t symbol;
+  };
+
+  bool load_table(ElfImage const& image, elf_shdr const& table, bool dynamic);
+  void load_gnu_hash(ElfImage const& image, elf_shdr const& table);
+  Symbol const* find_gnu_hash(char const* name, std::uint32_t hash) const;
+  void insert(std::uint32_t symbol, std::uint32_t hash);
+  void flatten_ranges();
+
+  std::vector<Symbol> m_symbols;
+
+  // Open addressing over the symbols that .gnu.hash doesn't cover: symbol index and its hash
+  std::vector<std::uint32_t> m_slots;
+  std::vector<std::uint32_t> m_slot_hashes;
+
+  // .gnu.hash of .dynsym, viewed in place
+  std::uint32_t m_gnu_bucket_count = 0;
+  std::uint32_t m_gnu_symoffset = 0;
+  std::uint32_t m_gnu_bloom_size = 0;
+  std::uint32_t m_gnu_bloom_shift = 0;
+  std::uint64_t const* m_gnu_bloom = nullptr;
+  std::uint32_t const* m_gnu_buckets = nullptr;
+  std::uint32_t const* m_gnu_chain = nullptr;
+  std::size_t m_gnu_chain_size = 0;
+  std::vector<std::uint32_t> m_dynsym_symbol;  // .dynsym index -> m_symbols index or NONE
+
+  // Sorted starts of the address ranges and the ranges themselves, flattened so that the range with the greatest
+  // start at or below an address is the innermost symbol covering it
+  std::vector<std::uint64_t> m_starts;
+  std::vector<Range> m_ranges;
+
+  char const* m_error = "";
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Mutex that spins a while and then sleeps in the kernel (a futex on Linux, yield elsewhere).
+// The lock word has three states, so unlock only makes a syscall when someone may be asleep:
+//   UNLOCKED
+//   LOCKED     held, nobody sleeps
+//   CONTENDED  held, waiters may sleep in futex_wait
+// The spin is test-and-test-and-set with pause and exponential backoff. Its length adapts: a spin that got
+// the lock raises the budget, one that had to sleep anyway lowers it, so a lock whose holders get preempted
+// or stay long stops burning the CPU.
+// Usable with std::lock_guard / std::unique_lock.
+class AdaptiveMutex {
+public:
+  static constexpr uint32_t UNLOCKED = 0;
+  static constexpr uint32_t LOCKED = 1;
+  static constexpr uint32_t CONTENDED = 2;
+
+  // Bounds of the spin budget, in lock-word reads
+  static constexpr uint32_t MIN_SPIN = 16;
+  static constexpr uint32_t MAX_SPIN = 1 << 12;
+  // Longest backoff between two reads, in pause instructions
+  static constexpr uint32_t MAX_BACKOFF = 64;
+
+  AdaptiveMutex() = default;
+  AdaptiveMutex(AdaptiveMutex const&) = delete;
+  AdaptiveMutex& operator=(AdaptiveMutex const&) = delete;
+
+  void lock() {
+    uint32_t expected = UNLOCKED;
+    if (!m_word.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed)) {
+      lock_slow();
+    }
+  }
+
+  bool try_lock() {
+    uint32_t expected = UNLOCKED;
+    return m_word.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed);
+  }
+
+  void unlock() {
+    if (m_word.exchange(UNLOCKED, std::memory_order_release) == CONTENDED) {
+      wake_one();
+    }
+  }
+
+  // The current spin budget
+  uint32_t spin_budget() const { return m_spin_budget.load(std::memory_order_relaxed); }
+  // Times a lock() went to sleep and unlock() made a wake syscall, approximate under contention
+  uint64_t sleeps() const { return m_sleeps.load(std::memory_order_relaxed); }
+  uint64_t wakes() const { return m_wakes.load(std::memory_order_relaxed); }
+
+private:
+  void lock_slow();
+  // Spins up to the budget, returns true if the lock was taken
+  bool spin();
+  void wait();
+  void wake_one();
+
+  // Updates the budget only if it changes, every write would invalidate the line of all spinners
+  void set_spin_budget(uint32_t old_budget, uint32_t new_budget);
+
+  // The lock word has its line to itself: the budget and the statistics are written on other paths
+  alignas(64) std::atomic<uint32_t> m_word { UNLOCKED };
+  alignas(64) std::atomic<uint32_t> m_spin_budget { MIN_SPIN * 8 };
+  alignas(64) std::atomic<uint64_t> m_sleeps { 0 };
+  std::atomic<uint64_t> m_wakes { 0 };
+};
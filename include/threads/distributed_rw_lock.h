@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "adaptive_mutex.h"
+#include "lock_policies.h"
+
+// Reader-writer lock for read-mostly data, after BRAVO (biased locking for reader-writer locks).
+// While the lock is reader-biased, a reader only marks its own slot of a per-thread table: readers on
+// different slots share no cache line, so reads scale with the threads. A writer revokes the bias and
+// waits for the marked slots to drain.
+// Everything else takes the slow path, a counter of readers next to a writer count:
+// - readers whose slot is taken, because more threads than SLOTS hash there;
+// - readers arriving while the bias is off.
+// Writers are preferred: once one announces itself, new readers wait until no writer is left. After a
+// revocation the bias stays off for INHIBIT_FACTOR times as long as the revocation took, so frequent
+// writers don't pay for draining the table each time.
+// Waiting threads yield, the lock is meant for machines that may run more threads than cores.
+class DistributedRWLock {
+public:
+  static constexpr int SLOTS = 64;
+  static constexpr uint64_t INHIBIT_FACTOR = 9;
+  // read_lock() result for a reader on the slow path
+  static constexpr int SHARED = -1;
+
+  DistributedRWLock() = default;
+  DistributedRWLock(DistributedRWLock const&) = delete;
+  DistributedRWLock& operator=(DistributedRWLock const&) = delete;
+
+  // Returns the token to hand to read_unlock, on the same thread
+  int read_lock();
+  void read_unlock(int token);
+  void write_lock();
+  void write_unlock();
+
+  // Reads that took the shared counter; the fast path counts nothing, that would share a line again
+  uint64_t slow_reads() const { return m_slow_reads.load(std::memory_order_relaxed); }
+  // Writes that had to revoke the reader bias
+  uint64_t revocations() const { return m_revocations.load(std::memory_order_relaxed); }
+
+private:
+  using Slot = PaddedLayout::Slot<std::atomic<uint32_t>>;
+
+  // The slot of the calling thread, threads get consecutive ones on first use
+  static int thread_slot();
+  void read_lock_slow();
+  void revoke_bias();
+
+  Slot m_slots[SLOTS] {};
+  PaddedLayout::Slot<std::atomic<bool>> m_bias { { true } };
+  PaddedLayout::Slot<std::atomic<uint32_t>> m_readers { { 0 } };  // on the slow path
+  PaddedLayout::Slot<std::atomic<uint32_t>> m_writers { { 0 } };  // waiting or writing
+  AdaptiveMutex m_write_mutex;  // orders the writers, they may wait long
+  std::atomic<uint64_t> m_inhibit_until { 0 };  // ns, the bias stays off until then
+  std::atomic<uint64_t> m_slow_reads { 0 };
+  std::atomic<uint64_t> m_revocations { 0 };
+};
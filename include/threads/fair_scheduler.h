@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+struct FairConfig {
+  uint64_t latency = 6;             // ticks in which every runnable thread should run once
+  uint64_t min_granularity = 1;     // shortest slice in ticks, however many threads there are
+  uint64_t wakeup_granularity = 1;  // a woken thread preempts only if it is this many nice-0 ticks behind
+};
+
+// Single-CPU completely fair scheduler with the event API of RoundRobinScheduler. A running thread accumulates
+// virtual runtime at a rate inverse to its weight (from its nice value, like Linux), and the CPU goes to the
+// runnable thread with the least of it. The runnable threads live in a red-black tree (std::set) keyed by
+// vruntime, so pick-next is O(log n). The current thread is out of the tree while it runs; it gets a slice of
+// 'latency' in proportion to its weight and is preempted when the slice is used up.
+// New and woken threads start at min_vruntime, so a thread that slept long can't monopolize the CPU to catch up.
+// Thread ids index a vector, so they should be small non-negative numbers.
+class FairScheduler {
+public:
+  static constexpr int NICE_MIN = -20;
+  static constexpr int NICE_MAX = 19;
+  // vruntime a nice 0 thread gains per tick
+  static constexpr uint64_t NICE_0_TICK = uint64_t(1) << 20;
+
+  // 'capacity' is the expected number of threads, their records are reserved for it
+  explicit FairScheduler(FairConfig const& config = FairConfig(), size_t capacity = 64);
+
+  // Forgets every thread and starts over with a new configuration
+  void setup(FairConfig const& config);
+
+  void new_thread(int thread_id) { new_thread(thread_id, 0); }
+  // 'nice' is clamped to [NICE_MIN, NICE_MAX]
+  void new_thread(int thread_id, int nice);
+  void exit_thread();
+  void block_thread();
+  void wake_thread(int thread_id);
+  void timer_tick();
+
+  // The thread on the CPU, -1 if no thread is runnable
+  int current_thread() const { return m_current; }
+  // Threads waiting in the tree, the current one excluded
+  size_t runnable() const { return m_tree.size(); }
+  uint64_t vruntime(int thread_id) const { return m_threads[thread_id].vruntime; }
+  uint64_t min_vruntime() const { return m_min_vruntime; }
+  uint32_t weight(int thread_id) const { return m_threads[thread_id].weight; }
+
+  static uint32_t nice_to_weight(int nice);
+
+private:
+  struct Thread {
+    uint64_t vruntime = 0;
+    uint64_t delta = 0;  // vruntime per tick
+    uint32_t weight = 0;
+  };
+
+  void make_runnable(int thread_id);
+  // Takes the leftmost thread of the tree, or leaves the CPU idle
+  void pick_next();
+  void start_slice();
+  void update_min_vruntime();
+
+  uint64_t m_latency = 6;
+  uint64_t m_min_granularity = 1;
+  uint64_t m_wakeup_granularity = NICE_0_TICK;  // in vruntime
+  int m_current = -1;
+  uint64_t m_ran = 0;    // ticks the current thread has run in this slice
+  uint64_t m_slice = 0;  // ticks it may run before it's preempted
+  uint64_t m_min_vruntime = 0;
+  uint64_t m_total_weight = 0;  // of the runnable threads, the current one included
+  std::set<std::pair<uint64_t, int>> m_tree;  // (vruntime, thread id) of the waiting threads
+  std::vector<Thread> m_threads;              // by thread id
+};
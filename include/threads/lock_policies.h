@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+// Policies the spin locks are parameterized on, so the same algorithm can be measured with and without
+// false sharing and with the default or the weakest correct memory ordering
+
+#ifdef __cpp_lib_hardware_interference_size
+constexpr size_t DESTRUCTIVE_INTERFERENCE_SIZE = std::hardware_destructive_interference_size;
+#else
+constexpr size_t DESTRUCTIVE_INTERFERENCE_SIZE = 64;
+#endif
+
+// A lock field; 'Align' decides whether neighbouring fields share a cache line
+template <typename T, size_t Align>
+struct alignas(Align) LockField {
+  T value;
+};
+
+// Layout policies: Slot<T> is the type of every field of the lock word
+
+// Fields next to each other, the lock takes a line or less and spinning readers false-share with writers
+struct PackedLayout {
+  template <typename T>
+  using Slot = LockField<T, alignof(T)>;
+};
+
+// Every field, and every element of an array field, on its own cache line
+struct PaddedLayout {
+  template <typename T>
+  using Slot = LockField<T, DESTRUCTIVE_INTERFERENCE_SIZE>;
+};
+
+// Memory-order policies, by the role of an operation:
+//   ACQUIRE  loads and RMWs that take the lock, nothing in the critical section moves before them
+//   RELEASE  stores and RMWs that hand the lock over, nothing in the critical section moves after them
+//   RELAXED  operations that only have to be atomic, like taking a ticket
+// Peterson-style locks publish a flag and then read the other threads' flags. That store-load order needs
+// seq_cst under either policy, so those operations use it explicitly.
+
+// What a plain load(), store() or fetch_add() does
+struct SeqCstOrder {
+  static constexpr std::memory_order ACQUIRE = std::memory_order_seq_cst;
+  static constexpr std::memory_order RELEASE = std::memory_order_seq_cst;
+  static constexpr std::memory_order RELAXED = std::memory_order_seq_cst;
+};
+
+// The weakest ordering the algorithms stay correct with. On x86 it turns the unlock stores into a plain mov
+// instead of xchg (loads and RMWs cost the same either way) and lets the compiler move code around them.
+struct AcquireReleaseOrder {
+  static constexpr std::memory_order ACQUIRE = std::memory_order_acquire;
+  static constexpr std::memory_order RELEASE = std::memory_order_release;
+  static constexpr std::memory_order RELAXED = std::memory_order_relaxed;
+};
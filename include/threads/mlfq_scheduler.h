@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MlfqConfig {
+  int levels = 8;               // priority levels, 0 is the highest, at most MlfqScheduler::MAX_LEVELS
+  int base_quantum = 1;         // ticks a thread may use at level 0, doubled at every level below
+  uint64_t boost_period = 100;  // ticks between priority boosts, 0 disables them
+};
+
+// Single-CPU multi-level feedback queue with the event API of RoundRobinScheduler. A thread starts at the top
+// level and drops one level once it has used up the quantum of its level; the quantum is charged across blocks,
+// so yielding just before the end of it doesn't keep a CPU hog on top. A runnable thread of a higher level
+// preempts the current one at once. Every 'boost_period' ticks all threads go back to the top, so a thread that
+// turns interactive recovers and the bottom can't starve.
+// Each level is an intrusive FIFO linked through the thread records, so a boost splices whole levels, and a bitmap
+// of the non-empty levels finds the highest one with a single bit scan.
+// Thread ids index a vector, so they should be small non-negative numbers.
+class MlfqScheduler {
+public:
+  static constexpr int MAX_LEVELS = 64;
+
+  // 'capacity' is the expected number of threads, their records are reserved for it
+  explicit MlfqScheduler(MlfqConfig const& config = MlfqConfig(), size_t capacity = 64);
+
+  // Forgets every thread and starts over with a new configuration
+  void setup(MlfqConfig const& config);
+
+  void new_thread(int thread_id) {
+    if (static_cast<size_t>(thread_id) >= m_threads.size()) {
+      m_threads.resize(thread_id + 1);
+    }
+    m_threads[thread_id] = Thread { 0, 0, m_epoch, -1 };
+    make_runnable(thread_id);
+  }
+
+  void exit_thread() { switch_to_next(); }
+  void block_thread() { switch_to_next(); }
+
+  void wake_thread(int thread_id) {
+    refresh(m_threads[thread_id]);
+    make_runnable(thread_id);
+  }
+
+  void timer_tick() {
+    if (m_current != -1) {
+      Thread& thread = m_threads[m_current];
+      if (++thread.used == m_quantum[thread.level]) {
+        if (thread.level + 1 < m_levels) {
+          ++thread.level;
+          ++m_demotions;
+        }
+        thread.used = 0;
+        enqueue(m_current, thread.level);
+        switch_to_next();
+      }
+    }
+    if (m_boost_period && ++m_since_boost == m_boost_period) {
+      boost();
+    }
+  }
+
+  // The thread on the CPU, -1 if no thread is runnable
+  int current_thread() const { return m_current; }
+  // Priority level of a thread that was created, 0 is the highest
+  int level(int thread_id) const {
+    Thread const& thread = m_threads[thread_id];
+    return thread.epoch == m_epoch ? thread.level : 0;
+  }
+  // Threads waiting in the run queues, the current one excluded
+  size_t runnable() const { return m_queued; }
+  uint64_t demotions() const { return m_demotions; }
+  uint64_t boosts() const { return m_epoch; }
+  int levels() const { return m_levels; }
+
+private:
+  struct Thread {
+    uint32_t level;
+    uint32_t used;   // ticks of the quantum of its level used up
+    uint32_t epoch;  // boosts seen, an older epoch means the thread is back at level 0
+    int next;        // next thread in the same run queue
+  };
+
+  struct Queue {
+    int head = -1;
+    int tail = -1;
+  };
+
+  // Applies the boosts the thread missed while it was blocked or queued
+  void refresh(Thread& thread) {
+    if (thread.epoch != m_epoch) {
+      thread = Thread { 0, 0, m_epoch, -1 };
+    }
+  }
+
+  void enqueue(int thread_id, uint32_t level) {
+    Queue& queue = m_queues[level];
+    m_threads[thread_id].next = -1;
+    if (queue.tail == -1) {
+      queue.head = thread_id;
+      m_nonempty |= uint64_t(1) << level;
+    } else {
+      m_threads[queue.tail].next = thread_id;
+    }
+    queue.tail = thread_id;
+    ++m_queued;
+  }
+
+  void make_runnable(int thread_id) {
+    if (m_current == -1) {
+      m_current = thread_id;
+      return;
+    }
+    uint32_t const level = m_threads[thread_id].level;
+    if (level < m_threads[m_current].level) {
+      enqueue(m_current, m_threads[m_current].level);  // preempted, keeps what it used of its quantum
+      m_current = thread_id;
+    } else {
+      enqueue(thread_id, level);
+    }
+  }
+
+  // Gives the CPU to the first thread of the highest non-empty level, or leaves it idle
+  void switch_to_next() {
+    if (!m_nonempty) {
+      m_current = -1;
+      return;
+    }
+    uint32_t const level = lowest_bit(m_nonempty);
+    Queue& queue = m_queues[level];
+    m_current = queue.head;
+    queue.head = m_threads[m_current].next;
+    if (queue.head == -1) {
+      queue.tail = -1;
+      m_nonempty &= ~(uint64_t(1) << level);
+    }
+    --m_queued;
+    refresh(m_threads[m_current]);
+  }
+
+  static uint32_t lowest_bit(uint64_t mask) {
+#if defined(__GNUC__)
+    return static_cast<uint32_t>(__builtin_ctzll(mask));
+#else
+    uint32_t bit = 0;
+    for (; !(mask & 1); mask >>= 1) {
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+
+  void boost();
+
+  int m_current = -1;
+  uint32_t m_levels = 1;
+  uint64_t m_boost_period = 0;
+  uint64_t m_since_boost = 0;
+  uint32_t m_epoch = 0;
+  uint64_t m_demotions = 0;
+  uint64_t m_nonempty = 0;  // bit i is set if m_queues[i] isn't empty
+  size_t m_queued = 0;
+  std::vector<uint32_t> m_quantum;
+  std::vector<Queue> m_queues;
+  std::vector<Thread> m_threads;  // by thread id
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "run_queue.h"
+
+// Where a woken thread is queued
+enum class WakePlacement {
+  PREVIOUS,  // the CPU it last ran on, for a warm cache
+  AFFINE,    // the previous CPU if it's idle, else the waker's CPU if it's idle, else any idle CPU, else the
+             // less loaded of the two
+  IDLEST,    // the CPU with the fewest threads
+};
+
+char const* wake_placement_name(WakePlacement placement);
+
+struct MultiCpuConfig {
+  int cpus = 4;
+  int timeslice = 1;  // round-robin quantum of every CPU
+  bool steal = true;  // a CPU that goes idle takes a queued thread from the most loaded CPU
+  WakePlacement placement = WakePlacement::AFFINE;
+};
+
+struct CpuStats {
+  uint64_t idle_ticks = 0;
+  uint64_t busy_ticks = 0;
+  uint64_t steals = 0;  // threads this CPU took from other queues
+};
+
+// Round-robin on several CPUs, each with its own current thread, quantum and run queue, so there is no shared
+// pool to contend on. New threads go to the least loaded CPU, woken threads where WakePlacement says, and idle
+// CPUs balance the load by stealing. The events name the CPU they happen on, like a kernel sees them.
+// Thread ids index a vector, so they should be small non-negative numbers.
+class MultiCpuScheduler {
+public:
+  // 'capacity' is the expected number of threads, every run queue is reserved for it
+  explicit MultiCpuScheduler(MultiCpuConfig const& config = MultiCpuConfig(), size_t capacity = 64);
+
+  // Forgets every thread and the statistics and starts over with a new configuration
+  void setup(MultiCpuConfig const& config);
+
+  void new_thread(int thread_id);
+  // The thread running on 'cpu' exits or blocks
+  void exit_thread(int cpu);
+  void block_thread(int cpu);
+  // 'waker_cpu' is the CPU the wakeup comes from, -1 for none (an interrupt or a timer)
+  void wake_thread(int thread_id, int waker_cpu = -1);
+  void timer_tick(int cpu);
+  // One tick on every CPU, then a sample of the queue-length imbalance
+  void timer_tick();
+
+  // The thread on 'cpu', -1 if it's idle
+  int current_thread(int cpu) const { return m_cpus[cpu].current; }
+  int cpus() const { return static_cast<int>(m_cpus.size()); }
+  // Threads on 'cpu', the running one included
+  size_t load(int cpu) const { return m_cpus[cpu].queue.size() + (m_cpus[cpu].current != -1 ? 1 : 0); }
+  // The CPU the thread ran on last, -1 if it hasn't run yet
+  int last_cpu(int thread_id) const { return m_last_cpu[thread_id]; }
+
+  CpuStats const& cpu_stats(int cpu) const { return m_cpus[cpu].stats; }
+  // Dispatches of a thread on a CPU other than the one it ran on before
+  uint64_t migrations() const { return m_migrations; }
+  // Difference between the most and the least loaded CPU, sampled by timer_tick()
+  double average_imbalance() const { return m_samples ? double(m_imbalance_sum) / m_samples : 0; }
+  size_t max_imbalance() const { return m_imbalance_max; }
+
+private:
+  struct Cpu {
+    int current = -1;
+    uint64_t time = 0;  // ticks the current thread has run in this quantum
+    RunQueue queue;
+    CpuStats stats;
+  };
+
+  void enqueue(int cpu, int thread_id);
+  void dispatch(int cpu, int thread_id);
+  // Runs the next queued thread of 'cpu', steals one or leaves the CPU idle
+  void switch_to_next(int cpu);
+  bool steal(int cpu);
+  int select_wake_cpu(int thread_id, int waker_cpu) const;
+  int idlest_cpu() const;
+
+  MultiCpuConfig m_config;
+  uint64_t m_timeslice = 1;
+  std::vector<Cpu> m_cpus;
+  std::vector<int> m_last_cpu;  // by thread id
+  size_t m_capacity;
+  uint64_t m_migrations = 0;
+  uint64_t m_samples = 0;
+  uint64_t m_imbalance_sum = 0;
+  size_t m_imbalance_max = 0;
+};
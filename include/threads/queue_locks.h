@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// FIFO spin locks where every waiter spins on its own cache line, so an unlock touches one waiter instead
+// of invalidating the line of all of them like TicketLock does
+
+// Mellor-Crummey and Scott: waiters form a linked list of their own nodes and each one spins on the
+// 'locked' flag of its node, which the predecessor clears on unlock
+class McsLock {
+public:
+  struct alignas(64) Node {
+    std::atomic<Node*> next { nullptr };
+    std::atomic<bool> locked { false };
+  };
+
+  // Holds the lock for its lifetime, the node lives in the guard
+  class Guard {
+  public:
+    explicit Guard(McsLock& lock) : m_lock(lock) { m_lock.lock(m_node); }
+    ~Guard() { m_lock.unlock(m_node); }
+    Guard(Guard const&) = delete;
+    Guard& operator=(Guard const&) = delete;
+
+  private:
+    McsLock& m_lock;
+    Node m_node;
+  };
+
+  McsLock() = default;
+  McsLock(McsLock const&) = delete;
+  McsLock& operator=(McsLock const&) = delete;
+
+  // 'node' must stay alive and untouched until the matching unlock
+  void lock(Node& node);
+  void unlock(Node& node);
+
+private:
+  alignas(64) std::atomic<Node*> m_tail { nullptr };
+};
+
+// Craig, Landin and Hagersten: waiters form an implicit list, each one spins on the node of its predecessor.
+// Unlock clears the holder's own node, and the holder then keeps the predecessor's node, which nobody
+// reads any more. Nodes therefore travel between threads. They come from a per-thread free list so callers
+// never allocate them; the lock owns the node at its tail.
+class ClhLock {
+public:
+  struct alignas(64) Node {
+    std::atomic<bool> locked { false };
+    Node* predecessor = nullptr;  // only read and written by the thread that queued the node
+
+    // Nodes live on the heap; plain new ignores alignas(64) before C++17 and would let them share lines
+    static void* operator new(size_t size);
+    static void operator delete(void* node);
+  };
+
+  class Guard {
+  public:
+    explicit Guard(ClhLock& lock) : m_lock(lock), m_node(lock.lock()) {}
+    ~Guard() { m_lock.unlock(m_node); }
+    Guard(Guard const&) = delete;
+    Guard& operator=(Guard const&) = delete;
+
+  private:
+    ClhLock& m_lock;
+    Node* m_node;
+  };
+
+  ClhLock();
+  ~ClhLock();
+  ClhLock(ClhLock const&) = delete;
+  ClhLock& operator=(ClhLock const&) = delete;
+
+  // Returns the node to hand to unlock, on the same thread
+  Node* lock();
+  void unlock(Node* node);
+
+private:
+  alignas(64) std::atomic<Node*> m_tail;
+};
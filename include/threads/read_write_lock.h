@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "lock_policies.h"
+
+// Ticket-based reader-writer lock: readers and writers are served in arrival order.
+// Layout and Order are the policies of lock_policies.h, instantiated for all four combinations;
+// RWLock is the packed seq_cst one.
+template <typename Layout = PackedLayout, typename Order = SeqCstOrder>
+struct BasicRWLock {
+  // Queue for threads
+  typename Layout::template Slot<std::atomic_uint64_t> ticket;
+  // Readers and writers
+  typename Layout::template Slot<std::atomic_uint64_t> read;
+  typename Layout::template Slot<std::atomic_uint64_t> write;
+};
+
+using RWLock = BasicRWLock<>;
+
+template <typename Layout, typename Order>
+void read_lock(BasicRWLock<Layout, Order>* lock);
+template <typename Layout, typename Order>
+void read_unlock(BasicRWLock<Layout, Order>* lock);
+template <typename Layout, typename Order>
+void write_lock(BasicRWLock<Layout, Order>* lock);
+template <typename Layout, typename Order>
+void write_unlock(BasicRWLock<Layout, Order>* lock);
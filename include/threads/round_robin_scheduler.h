@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+
+#include "run_queue.h"
+
+// Single-CPU round-robin scheduler. The running thread is preempted after 'timeslice' calls of timer_tick()
+// and goes to the back of the run queue. All state lives in the object, so any number of schedulers can run
+// side by side, one per simulation thread.
+class RoundRobinScheduler {
+public:
+  // 'capacity' is the expected number of runnable threads, the run queue is reserved for it
+  explicit RoundRobinScheduler(int timeslice = 1, size_t capacity = 64);
+
+  // Forgets every thread and starts over with a new quantum
+  void setup(int timeslice);
+
+  // The event API is inline, a simulation calls it per event
+  void new_thread(int thread_id) {
+    if (m_current == -1) {
+      m_current = thread_id;
+      m_time = 0;
+    } else {
+      m_queue.push_back(thread_id);
+    }
+  }
+
+  void exit_thread() { switch_to_next(); }
+  void block_thread() { switch_to_next(); }
+  void wake_thread(int thread_id) { new_thread(thread_id); }
+
+  void timer_tick() {
+    ++m_time;
+    if (m_time == m_timeslice) {
+      if (!m_queue.empty()) {
+        m_queue.push_back(m_current);
+        m_current = m_queue.pop_front();
+      }
+      m_time = 0;
+    }
+  }
+
+  // The same as 'ticks' calls of timer_tick() but O(queue length) at most: the current thread and the queue
+  // form a ring that turns by one thread per quantum, so only the number of turns modulo its length matters
+  void advance(uint64_t ticks) {
+    if (m_timeslice == 0) {
+      m_time += ticks;  // timer_tick() never reaches a quantum of 0, the current thread keeps the CPU
+      return;
+    }
+    uint64_t const total = m_time + ticks;
+    m_time = total % m_timeslice;
+    if (m_queue.empty()) {
+      return;
+    }
+    size_t const turns = static_cast<size_t>(total / m_timeslice % (m_queue.size() + 1));
+    if (turns) {
+      m_queue.push_back(m_current);
+      m_queue.rotate(turns - 1);
+      m_current = m_queue.pop_front();
+    }
+  }
+
+  // Ticks until the current thread is preempted if nothing else happens, UINT64_MAX if nothing would preempt it
+  uint64_t next_switch() const { return m_queue.empty() || m_timeslice == 0 ? UINT64_MAX : m_timeslice - m_time; }
+
+  // The thread on the CPU, -1 if no thread is runnable
+  int current_thread() const { return m_current; }
+  // Threads waiting in the run queue, the current one excluded
+  size_t runnable() const { return m_queue.size(); }
+  int timeslice() const { return static_cast<int>(m_timeslice); }
+
+private:
+  // Gives the CPU to the next queued thread, or leaves it idle
+  void switch_to_next() {
+    if (m_queue.empty()) {
+      m_current = -1;
+    } else {
+      m_current = m_queue.pop_front();
+      m_time = 0;
+    }
+  }
+
+  int m_current = -1;
+  uint64_t m_timeslice = 1;
+  uint64_t m_time = 0;  // ticks the current thread has run in this quantum
+  RunQueue m_queue;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// FIFO of thread ids in a power-of-two ring buffer. The storage is reserved up front and only grows
+// (doubling) if more threads than 'capacity' are queued at once, so steady-state push/pop never allocate.
+class RunQueue {
+public:
+  explicit RunQueue(size_t capacity = 64) {
+    size_t size = 1;
+    while (size < capacity) {
+      size *= 2;
+    }
+    m_slots.resize(size);
+  }
+
+  bool empty() const { return m_size == 0; }
+  size_t size() const { return m_size; }
+  size_t capacity() const { return m_slots.size(); }
+
+  int front() const { return m_slots[m_head]; }
+  // i-th thread from the front
+  int at(size_t i) const { return m_slots[(m_head + i) & (m_slots.size() - 1)]; }
+
+  void push_back(int thread_id) {
+    if (m_size == m_slots.size()) {
+      grow();
+    }
+    m_slots[(m_head + m_size) & (m_slots.size() - 1)] = thread_id;
+    ++m_size;
+  }
+
+  int pop_front() {
+    int const thread_id = m_slots[m_head];
+    m_head = (m_head + 1) & (m_slots.size() - 1);
+    --m_size;
+    return thread_id;
+  }
+
+  // Takes the thread that was queued last, for stealing work from another queue
+  int pop_back() {
+    --m_size;
+    return m_slots[(m_head + m_size) & (m_slots.size() - 1)];
+  }
+
+  // Moves the first 'count' threads to the back in their order, 'count' is at most size()
+  void rotate(size_t count) {
+    if (m_size == m_slots.size()) {
+      m_head = (m_head + count) & (m_slots.size() - 1);  // a full ring rotates by moving the head
+      return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      push_back(pop_front());
+    }
+  }
+
+  void clear() {
+    m_head = 0;
+    m_size = 0;
+  }
+
+private:
+  void grow() {
+    std::vector<int> slots(m_slots.size() * 2);
+    for (size_t i = 0; i < m_size; ++i) {
+      slots[i] = at(i);
+    }
+    m_slots.swap(slots);
+    m_head = 0;
+  }
+
+  std::vector<int> m_slots;
+  size_t m_head = 0;
+  size_t m_size = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "lock_policies.h"
+
+// Spin locks built on read-modify-write operations.
+// Layout and Order are the policies of lock_policies.h. The algorithms are instantiated for PackedLayout and
+// PaddedLayout with SeqCstOrder and AcquireReleaseOrder, and Mutex is the packed seq_cst one.
+
+namespace RMWLock {
+  constexpr int LOCKED = 1;
+  constexpr int UNLOCKED = 0;
+
+  template <typename Layout = PackedLayout, typename Order = SeqCstOrder>
+  struct BasicMutex {
+    typename Layout::template Slot<std::atomic<uint64_t>> locked;
+  };
+
+  using Mutex = BasicMutex<>;
+
+  template <typename Layout, typename Order>
+  void lock(BasicMutex<Layout, Order> * lock);
+  template <typename Layout, typename Order>
+  void unlock(BasicMutex<Layout, Order> * lock);
+}
+
+namespace TicketLock {
+  template <typename Layout = PackedLayout, typename Order = SeqCstOrder>
+  struct BasicMutex {
+    typename Layout::template Slot<std::atomic<uint64_t>> next;
+    typename Layout::template Slot<std::atomic<uint64_t>> ticket;
+  };
+
+  using Mutex = BasicMutex<>;
+
+  template <typename Layout, typename Order>
+  void lock(BasicMutex<Layout, Order> * lock);
+  template <typename Layout, typename Order>
+  void unlock(BasicMutex<Layout, Order> * lock);
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Per-thread latency accounting for any scheduler with the new_thread/exit_thread/block_thread/wake_thread/
+// timer_tick/current_thread API. Time is counted in ticks; events happen between ticks.
+struct ThreadStats {
+  uint64_t arrival = 0;       // tick of new_thread
+  uint64_t first_run = 0;     // valid if 'started'
+  uint64_t finish = 0;        // valid if 'finished'
+  uint64_t cpu = 0;           // ticks on the CPU
+  uint64_t wait = 0;          // ticks runnable but not running
+  uint64_t wakeups = 0;
+  uint64_t wake_latency = 0;  // sum over wakeups of the ticks from wake_thread to the next run
+  uint64_t max_wake_latency = 0;
+  bool started = false;
+  bool finished = false;
+
+  uint64_t response() const { return first_run - arrival; }
+  uint64_t turnaround() const { return finish - arrival; }
+};
+
+// Wraps a scheduler and watches current_thread() after every event to see dispatches, preemptions and waits.
+// Thread ids index a vector, so they should be small non-negative numbers.
+template <typename Scheduler>
+class TrackedScheduler {
+public:
+  template <typename... Args>
+  explicit TrackedScheduler(Args&&... args) : m_scheduler(std::forward<Args>(args)...) {}
+
+  // 'extra' goes to the scheduler as is, like a nice value
+  template <typename... Extra>
+  void new_thread(int thread_id, Extra... extra) {
+    ThreadStats& stats = at(thread_id);
+    stats = ThreadStats();
+    stats.arrival = m_now;
+    m_state[thread_id] = State { RUNNABLE, m_now, false };
+    m_scheduler.new_thread(thread_id, extra...);
+    observe();
+  }
+
+  void exit_thread() {
+    if (m_running >= 0) {
+      m_stats[m_running].finish = m_now;
+      m_stats[m_running].finished = true;
+      m_state[m_running].kind = GONE;
+      m_running = -1;
+    }
+    m_scheduler.exit_thread();
+    observe();
+  }
+
+  void block_thread() {
+    if (m_running >= 0) {
+      m_state[m_running].kind = GONE;
+      m_running = -1;
+    }
+    m_scheduler.block_thread();
+    observe();
+  }
+
+  void wake_thread(int thread_id) {
+    ++m_stats[thread_id].wakeups;
+    m_state[thread_id] = State { RUNNABLE, m_now, true };
+    m_scheduler.wake_thread(thread_id);
+    observe();
+  }
+
+  void timer_tick() {
+    ++m_now;
+    if (m_running >= 0) {
+      ++m_stats[m_running].cpu;
+    } else {
+      ++m_idle;
+    }
+    m_scheduler.timer_tick();
+    observe();
+  }
+
+  int current_thread() const { return m_scheduler.current_thread(); }
+
+  Scheduler& scheduler() { return m_scheduler; }
+  // Indexed by thread id, ids never created have arrival 0 and 'started' false
+  std::vector<ThreadStats> const& stats() const { return m_stats; }
+  uint64_t now() const { return m_now; }
+  uint64_t idle_ticks() const { return m_idle; }
+  uint64_t context_switches() const { return m_switches; }
+
+private:
+  enum Kind { RUNNABLE, RUNNING, GONE };  // GONE: blocked or exited
+
+  struct State {
+    Kind kind;
+    uint64_t ready_since;  // tick it became runnable
+    bool woken;            // became runnable through wake_thread
+  };
+
+  ThreadStats& at(int thread_id) {
+    if (static_cast<size_t>(thread_id) >= m_stats.size()) {
+      m_stats.resize(thread_id + 1);
+      m_state.resize(thread_id + 1, State { GONE, 0, false });
+    }
+    return m_stats[thread_id];
+  }
+
+  void observe() {
+    int const current = m_scheduler.current_thread();
+    if (current == m_running) {
+      return;
+    }
+    if (m_running >= 0) {
+      m_state[m_running] = State { RUNNABLE, m_now, false };  // preempted
+    }
+    if (current >= 0) {
+      State& state = m_state[current];
+      ThreadStats& stats = m_stats[current];
+      uint64_t const waited = m_now - state.ready_since;
+      stats.wait += waited;
+      if (!stats.started) {
+        stats.started = true;
+        stats.first_run = m_now;
+      }
+      if (state.woken) {
+        stats.wake_latency += waited;
+        stats.max_wake_latency = waited > stats.max_wake_latency ? waited : stats.max_wake_latency;
+      }
+      state = State { RUNNING, m_now, false };
+      ++m_switches;
+    }
+    m_running = current;
+  }
+
+  Scheduler m_scheduler;
+  std::vector<ThreadStats> m_stats;
+  std::vector<State> m_state;
+  int m_running = -1;
+  uint64_t m_now = 0;
+  uint64_t m_idle = 0;
+  uint64_t m_switches = 0;
+};
+
+// How far the CPU time of threads that were runnable all along is from their weighted fair share
+struct FairnessReport {
+  size_t threads = 0;
+  double min_deviation = 0;  // of CPU share from the expected share, -0.1 is 10% less than the fair share
+  double max_deviation = 0;
+  double mean_abs_deviation = 0;
+};
+
+// 'weights' by thread id, threads with weight 0 are left out. The expected share of a thread is its weight over
+// the total weight, its actual share its CPU ticks over the total ticks of the threads taken into account.
+inline FairnessReport fairness_report(std::vector<ThreadStats> const& stats, std::vector<double> const& weights) {
+  FairnessReport res;
+  double total_weight = 0, total_cpu = 0;
+  for (size_t id = 0; id < stats.size() && id < weights.size(); ++id) {
+    if (weights[id] > 0) {
+      total_weight += weights[id];
+      total_cpu += static_cast<double>(stats[id].cpu);
+    }
+  }
+  if (total_weight == 0 || total_cpu == 0) {
+    return res;
+  }
+  bool first = true;
+  for (size_t id = 0; id < stats.size() && id < weights.size(); ++id) {
+    if (weights[id] <= 0) {
+      continue;
+    }
+    double const deviation = (stats[id].cpu / total_cpu) / (weights[id] / total_weight) - 1;
+    res.min_deviation = first || deviation < res.min_deviation ? deviation : res.min_deviation;
+    res.max_deviation = first || deviation > res.max_deviation ? deviation : res.max_deviation;
+    res.mean_abs_deviation += deviation < 0 ? -deviation : deviation;
+    ++res.threads;
+    first = false;
+  }
+  res.mean_abs_deviation /= res.threads;
+  return res;
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../fast_io.h"
+#include "scheduler_stats.h"
+
+// Binary trace of scheduler events for replaying a workload against any policy.
+// Layout, little endian:
+//   TraceHeader
+//   TraceEvent records up to the end of the file, so a trace can be written as a stream
+// Each record holds the ticks since the previous record and one event at that time. Gaps longer than
+// 2^32 - 1 ticks are split with TICK records.
+
+static constexpr char const TRACE_MAGIC[8] = { 'O', 'S', 'S', 'C', 'H', 'T', 'R', 'C' };
+static constexpr uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+};
+
+enum class TraceEventKind : uint32_t {
+  CREATE,  // new_thread(thread)
+  BLOCK,   // the thread blocks, it has to be running for that
+  WAKE,    // wake_thread(thread)
+  EXIT,    // the thread exits, it has to be running for that
+  TICK,    // only time passes
+  // The 4-bit kind field has room for more, a record with any other value is corrupt
+  KIND_COUNT,
+};
+
+struct TraceEvent {
+  static constexpr uint32_t THREAD_BITS = 28;
+  static constexpr uint32_t MAX_THREAD = (1u << THREAD_BITS) - 1;
+
+  uint32_t delta;  // ticks since the previous record
+  uint32_t word;   // kind << THREAD_BITS | thread
+
+  TraceEventKind kind() const { return static_cast<TraceEventKind>(word >> THREAD_BITS); }
+  int thread() const { return static_cast<int>(word & MAX_THREAD); }
+};
+
+// Streams events in time order to a trace file
+class TraceWriter {
+public:
+  bool open(char const* path);
+  // Returns false if any write failed
+  bool close();
+
+  // 'time' is absolute and must not go back; returns false if it does or 'thread' is out of range
+  bool add(TraceEventKind kind, uint64_t time, int thread);
+  uint64_t event_count() const { return m_count; }
+
+private:
+  BufferedWriter m_out;
+  uint64_t m_time = 0;
+  uint64_t m_count = 0;
+};
+
+// Maps a trace file and checks its header, the records are read in place
+class SchedulerTrace {
+public:
+  bool open(char const* path);
+
+  TraceEvent const* events() const { return m_events; }
+  size_t event_count() const { return m_count; }
+  // Why the last open failed
+  char const* error() const { return m_error; }
+
+private:
+  bool fail(char const* error);
+
+  MappedFile m_file;
+  TraceEvent const* m_events = nullptr;
+  size_t m_count = 0;
+  char const* m_error = "";
+};
+
+struct ReplaySummary {
+  std::string policy;             // any text, escaped in the JSON
+  uint64_t events = 0;
+  uint64_t ticks = 0;
+  uint64_t threads = 0;           // created
+  uint64_t finished = 0;          // exited
+  uint64_t context_switches = 0;
+  uint64_t idle_ticks = 0;
+  uint64_t deferred = 0;          // BLOCK/EXIT of a waiting thread, applied once it got the CPU
+  uint64_t cancelled = 0;         // deferred BLOCKs undone by a WAKE before the thread ran again
+  uint64_t ignored = 0;           // events that make no sense in the thread's state, like a WAKE of a runnable thread
+  uint64_t invalid = 0;           // records of an unknown kind, skipped with their delta since it can't be trusted
+  double avg_turnaround = 0;      // over the finished threads
+  double avg_wait = 0;            // over the created threads
+  double avg_response = 0;        // over the threads that ran
+  uint64_t max_response = 0;
+  double seconds = 0;             // wall time of the replay
+};
+
+// Appends the summary as one JSON object and a newline
+void format_replay_summary(ReplaySummary const& summary, std::string& out);
+
+// Replays the events against 'scheduler', which has the new_thread...current_thread API and starts empty.
+// Time advances with timer_tick() calls. The scheduler decides who runs, so a BLOCK or EXIT may name a thread
+// that is waiting under this policy: it is applied the moment the thread gets the CPU.
+// Records of an unknown kind are counted as invalid and skipped.
+// Everything but 'policy' and 'seconds' of the summary is filled in.
+template <typename Scheduler>
+void replay_trace(TraceEvent const* events, size_t const count, Scheduler& scheduler, ReplaySummary& summary) {
+  enum : uint8_t { UNKNOWN, RUNNABLE, BLOCKED, EXITED };
+  enum : uint8_t { NONE, BLOCK_PENDING, EXIT_PENDING };
+  struct Thread {
+    uint8_t state;
+    uint8_t pending;
+  };
+
+  TrackedScheduler<Scheduler&> tracked(scheduler);
+  std::vector<Thread> threads;
+  uint64_t deferred = 0, cancelled = 0, ignored = 0, invalid = 0;
+
+  // BLOCK and EXIT wait until their thread runs, a thread may block and the next one exit right away
+  auto const apply_pending = [&]() {
+    for (int current = tracked.current_thread(); current != -1 && threads[current].pending != NONE;
+         current = tracked.current_thread()) {
+      Thread& thread = threads[current];
+      if (thread.pending == BLOCK_PENDING) {
+        thread.state = BLOCKED;
+        tracked.block_thread();
+      } else {
+        thread.state = EXITED;
+        tracked.exit_thread();
+      }
+      thread.pending = NONE;
+    }
+  };
+
+  for (size_t i = 0; i < count; ++i) {
+    TraceEvent const event = events[i];
+    if (event.kind() >= TraceEventKind::KIND_COUNT) {
+      ++invalid;
+      continue;
+    }
+    for (uint32_t tick = 0; tick < event.delta; ++tick) {
+      tracked.timer_tick();
+      apply_pending();
+    }
+    int const id = event.thread();
+    TraceEventKind const kind = event.kind();
+    if (kind == TraceEventKind::TICK) {
+      continue;
+    }
+    if (kind == TraceEventKind::CREATE) {
+      if (static_cast<size_t>(id) >= threads.size()) {
+        threads.resize(id + 1, Thread { UNKNOWN, NONE });
+      }
+      if (threads[id].state != UNKNOWN) {
+        ++ignored;
+        continue;
+      }
+      threads[id].state = RUNNABLE;
+      tracked.new_thread(id);
+    } else if (static_cast<size_t>(id) >= threads.size()) {
+      ++ignored;
+      continue;
+    } else if (kind == TraceEventKind::WAKE) {
+      Thread& thread = threads[id];
+      if (thread.state == BLOCKED) {
+        thread.state = RUNNABLE;
+        tracked.wake_thread(id);
+      } else if (thread.pending == BLOCK_PENDING) {
+        thread.pending = NONE;
+        ++cancelled;
+      } else {
+        ++ignored;
+      }
+    } else {
+      Thread& thread = threads[id];
+      if (thread.state != RUNNABLE || thread.pending != NONE) {
+        ++ignored;
+        continue;
+      }
+      thread.pending = kind == TraceEventKind::BLOCK ? BLOCK_PENDING : EXIT_PENDING;
+      if (tracked.current_thread() != id) {
+        ++deferred;
+      }
+    }
+    apply_pending();
+  }
+
+  summary.events = count;
+  summary.ticks = tracked.now();
+  summary.context_switches = tracked.context_switches();
+  summary.idle_ticks = tracked.idle_ticks();
+  summary.deferred = deferred;
+  summary.cancelled = cancelled;
+  summary.ignored = ignored;
+  summary.invalid = invalid;
+  summary.threads = summary.finished = 0;
+  summary.max_response = 0;
+  uint64_t turnaround = 0, wait = 0, response = 0, started = 0;
+  for (size_t id = 0; id < threads.size(); ++id) {
+    if (threads[id].state == UNKNOWN) {
+      continue;
+    }
+    ThreadStats const& stats = tracked.stats()[id];
+    ++summary.threads;
+    wait += stats.wait;
+    if (stats.started) {
+      ++started;
+      response += stats.response();
+      summary.max_response = std::max(summary.max_response, stats.response());
+    }
+    if (stats.finished) {
+      ++summary.finished;
+      turnaround += stats.turnaround();
+    }
+  }
+  summary.avg_turnaround = summary.finished ? double(turnaround) / summary.finished : 0;
+  summary.avg_wait = summary.threads ? double(wait) / summary.threads : 0;
+  summary.avg_response = started ? double(response) / started : 0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "lock_policies.h"
+
+// Mutual exclusion from atomic reads and writes only, see src/threads/thread_synchronization.cpp.
+// The algorithms index their arrays by thread: 0 and 1 for two threads, 0..N-1 for N. The overloads without
+// an index take threadId(), which is an index only if the threads were numbered that way, so callers with
+// ordinary threads pass their own index as 'me'.
+// Peterson2Threads and OptimizedPeterson take the Layout and Order policies of lock_policies.h like the RMW
+// locks; the overloads without an index exist for the default Mutex only.
+
+typedef uint64_t ThID;
+
+ThID threadId();
+void dumpThreadId();
+
+namespace Alternation {
+  struct Mutex {
+    std::atomic<ThID> victim;
+  };
+
+  void lock_init(Mutex *lock);
+  void lock(Mutex *lock);
+  void unlock(Mutex *lock);
+}
+
+namespace IntentionFlags {
+  struct Mutex {
+    std::array<std::atomic<ThID>, 2> flag;
+  };
+
+  void lock_init(Mutex *lock);
+  void lock(Mutex *lock);
+  void unlock(Mutex *lock);
+}
+
+namespace Peterson2Threads {
+  template <typename Layout = PackedLayout, typename Order = SeqCstOrder>
+  struct BasicMutex {
+    typename Layout::template Slot<std::atomic<ThID>> victim;
+    std::array<typename Layout::template Slot<std::atomic<ThID>>, 2> flag;
+  };
+
+  using Mutex = BasicMutex<>;
+
+  void lock_init(Mutex *lock);
+  void lock(Mutex *lock);
+  template <typename Layout, typename Order>
+  void lock(BasicMutex<Layout, Order> *lock, ThID me);
+  void unlock(Mutex *lock);
+  template <typename Layout, typename Order>
+  void unlock(BasicMutex<Layout, Order> *lock, ThID me);
+}
+
+namespace PetersonGreedy {
+  constexpr int N = 10;
+
+  struct LockOne {
+    std::atomic<ThID> victim;
+    std::array<std::atomic<ThID>, N> flags;
+  };
+
+  bool flags_clear(LockOne *lock);
+  bool flags_clear(LockOne *lock, ThID me);
+  void lock_one(LockOne *lock);
+  void lock_one(LockOne *lock, ThID me);
+  void unlock_one(LockOne *lock);
+  void unlock_one(LockOne *lock, ThID me);
+
+  struct Mutex {
+    std::array<LockOne, N -1> locks;
+  };
+
+  void lock(Mutex *mutex);
+  void lock(Mutex *mutex, ThID me);
+  void unlock(Mutex *mutex);
+  void unlock(Mutex *mutex, ThID me);
+}
+
+namespace OptimizedPeterson {
+  constexpr int N = 10;
+
+  template <typename Layout = PackedLayout, typename Order = SeqCstOrder>
+  struct BasicMutex {
+    // the length of the 1's prefix|postfix (1111 ... 000 or 000....11111)
+    std::array<typename Layout::template Slot<std::atomic<ThID>>, N> level;
+    std::array<typename Layout::template Slot<std::atomic<ThID>>, N - 1> victim;
+  };
+
+  using Mutex = BasicMutex<>;
+
+  template <typename Layout, typename Order>
+  bool flags_clear(BasicMutex<Layout, Order>* lock, ThID me, int level);
+  void lock(Mutex* lock);
+  template <typename Layout, typename Order>
+  void lock(BasicMutex<Layout, Order>* lock, ThID me);
+  void unlock(Mutex* lock);
+  template <typename Layout, typename Order>
+  void unlock(BasicMutex<Layout, Order>* lock, ThID me);
+}
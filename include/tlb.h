@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "mapping.h"
+
+// TLB and paging-structure caches in front of map_addr
+
+enum class Replacement {
+  LRU,
+  PSEUDO_LRU,  // tree pseudo-LRU, needs a power of two ways (falls back to LRU otherwise)
+};
+
+// Set-associative cache of 64-bit keys. 'ways' == 0 or 'ways' >= 'entries' makes it fully associative.
+// The number of sets is rounded down to a power of two.
+class SetAssociativeCache {
+public:
+  SetAssociativeCache(size_t entries, size_t ways, Replacement replacement);
+
+  // Returns true and the cached value on hit, updates the replacement state
+  bool lookup(uint64_t key, uint64_t& value);
+  void insert(uint64_t key, uint64_t value);
+  void clear();
+
+  size_t capacity() const { return m_lines.size(); }
+
+private:
+  struct Line {
+    uint64_t key;
+    uint64_t value;
+    uint64_t last_use;  // LRU stamp, 0 for an empty line
+  };
+
+  void touch(size_t set, size_t way);
+  size_t victim(size_t set) const;
+
+  std::vector<Line> m_lines;
+  std::vector<uint64_t> m_plru;  // tree bits for every set
+  size_t m_sets = 0;
+  size_t m_ways = 0;
+  uint64_t m_clock = 0;
+  bool m_pseudo_lru = false;
+};
+
+struct TlbConfig {
+  // 0 entries disables a cache
+  size_t l1_entries = 64;
+  size_t l1_ways = 4;
+  size_t l2_entries = 1024;
+  size_t l2_ways = 8;
+  // Paging-structure caches are fully associative:
+  size_t pml4_entries = 4;   // PLM4 entries keyed by bits 47:39
+  size_t pdpt_entries = 16;  // DirectoryPtr entries keyed by bits 47:30
+  size_t pd_entries = 32;    // Directory entries keyed by bits 47:21
+  Replacement replacement = Replacement::LRU;
+};
+
+struct TlbStats {
+  uint64_t translations = 0;
+  uint64_t l1_hits = 0;
+  uint64_t l2_hits = 0;
+  uint64_t pml4_hits = 0;
+  uint64_t pdpt_hits = 0;
+  uint64_t pd_hits = 0;
+  uint64_t walks = 0;
+  uint64_t levels_touched = 0;  // page-table entries read from memory
+  uint64_t faults = 0;
+};
+
+void print_tlb_stats(TlbStats const& stats, FILE* out);
+
+// Translates logical addresses like map_addr, but hits in the TLB skip the walk
+// and hits in the paging-structure caches start it from a lower level.
+// Faults are never cached, the page table is read-only so the caches never go stale.
+class TranslationCache {
+public:
+  TranslationCache(PhysicalMemory const& memory, uint64_t root_address, TlbConfig const& config = TlbConfig());
+
+  // Returns the physical address or TRANSLATION_FAULT
+  uint64_t translate(uint64_t logical_addr);
+
+  // Drops every cached translation, like a CR3 reload
+  void flush();
+
+  TlbStats const& stats() const { return m_stats; }
+  void reset_stats() { m_stats = TlbStats(); }
+
+private:
+  PhysicalMemory const& m_memory;
+  uint64_t const m_root_address;
+  SetAssociativeCache m_l1;
+  SetAssociativeCache m_l2;
+  SetAssociativeCache m_pml4;
+  SetAssociativeCache m_pdpt;
+  SetAssociativeCache m_pd;
+  TlbStats m_stats;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <functional>
+
+#include "mapping.h"
+
+// Multithreaded translation pipeline: the calling thread parses the queries in chunks, a pool of workers translates
+// and formats the chunks with translate_batch/format_translations, a writer thread emits them in input order.
+// The page table is read-only after loading, so the workers share it without locks.
+// The output is byte-identical to the sequential testMapping() output.
+
+struct PipelineOptions {
+  size_t workers = 0;          // 0 means std::thread::hardware_concurrency()
+  size_t chunk_size = 1 << 16; // queries per chunk
+  size_t max_in_flight = 0;    // chunks parsed but not written yet, bounds the memory; 0 means 4 per worker
+};
+
+// Fills 'logical' with up to 'max_count' queries, returns how many were read, 0 at the end of the input
+using QuerySource = std::function<size_t(uint64_t* logical, size_t max_count)>;
+// Receives the formatted output, always called from the same thread and in input order
+using OutputSink = std::function<void(char const* data, size_t size)>;
+
+// Returns the number of translated queries
+size_t run_translation_pipeline(PhysicalMemory const& memory, uint64_t root_address,
+                                QuerySource const& source, OutputSink const& sink,
+                                PipelineOptions const& options = PipelineOptions());
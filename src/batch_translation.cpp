@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "../include/batch_translation.h"
+
+namespace {
+  // A block of queries is sorted by keys "page number << BLOCK_BITS | position in the block"
+  constexpr uint64_t BLOCK_BITS = 14;
+  constexpr size_t BLOCK_SIZE = size_t(1) << BLOCK_BITS;
+  constexpr uint64_t KEY_SHIFT = BLOCK_BITS - VIRTUAL_PAGE_MASK.shift;  // (addr & page mask) << KEY_SHIFT
+  constexpr uint64_t RADIX_BITS = 12;
+  constexpr size_t RADIX_SIZE = size_t(1) << RADIX_BITS;
+
+  // Page number bits 35:0 = logical address bits 47:12, the upper levels are selected by its top bits
+  constexpr uint64_t DIRECTORY_PREFIX_SHIFT = DIRECTORY_MASK.shift - VIRTUAL_PAGE_MASK.shift;
+  constexpr uint64_t DIRECTORY_PTR_PREFIX_SHIFT = DIRECTORY_PTR_MASK.shift - VIRTUAL_PAGE_MASK.shift;
+  constexpr uint64_t PLM4_PREFIX_SHIFT = PLM4_MASK.shift - VIRTUAL_PAGE_MASK.shift;
+
+  void extract_keys(uint64_t const* logical, size_t const count, uint64_t* keys) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256i const page_mask = _mm256_set1_epi64x(static_cast<long long>(VIRTUAL_PAGE_MASK.mask));
+    __m256i const step = _mm256_set1_epi64x(4);
+    __m256i position = _mm256_set_epi64x(3, 2, 1, 0);
+    for (; i + 4 <= count; i += 4) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(logical + i));
+      v = _mm256_slli_epi64(_mm256_and_si256(v, page_mask), KEY_SHIFT);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(keys + i), _mm256_or_si256(v, position));
+      position = _mm256_add_epi64(position, step);
+    }
+#elif defined(__SSE2__)
+    __m128i const page_mask = _mm_set1_epi64x(static_cast<long long>(VIRTUAL_PAGE_MASK.mask));
+    __m128i const step = _mm_set1_epi64x(2);
+    __m128i position = _mm_set_epi64x(1, 0);
+    for (; i + 2 <= count; i += 2) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(logical + i));
+      v = _mm_slli_epi64(_mm_and_si128(v, page_mask), KEY_SHIFT);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(keys + i), _mm_or_si128(v, position));
+      position = _mm_add_epi64(position, step);
+    }
+#endif
+    for (; i < count; ++i) {
+      keys[i] = ((logical[i] & VIRTUAL_PAGE_MASK.mask) << KEY_SHIFT) | i;
+    }
+  }
+
+  // LSD radix sort by the page number bits of the keys, a pass is skipped if all keys share its digit
+  void sort_keys(uint64_t*& keys, uint64_t*& buffer, size_t const count, std::vector<uint32_t>& histogram) {
+    for (uint64_t shift = BLOCK_BITS; shift < BLOCK_BITS + 36; shift += RADIX_BITS) {
+      histogram.assign(RADIX_SIZE, 0);
+      for (size_t i = 0; i < count; ++i) {
+        ++histogram[(keys[i] >> shift) & (RADIX_SIZE - 1)];
+      }
+      if (histogram[(keys[0] >> shift) & (RADIX_SIZE - 1)] == count) {
+        continue;
+      }
+
+      uint32_t offset = 0;
+      for (auto& bucket : histogram) {
+        uint32_t const size = bucket;
+        bucket = offset;
+        offset += size;
+      }
+      for (size_t i = 0; i < count; ++i) {
+        buffer[histogram[(keys[i] >> shift) & (RADIX_SIZE - 1)]++] = keys[i];
+      }
+      std::swap(keys, buffer);
+    }
+  }
+
+  // Walks the sorted block. entry[level] caches the entry read at that level for the previous page,
+  // an entry that is not present is cached as 0, so are all the entries below it.
+  void translate_sorted(PhysicalMemory const& memory, uint64_t const root_address,
+                        uint64_t const* logical, uint64_t const* keys, size_t const count, uint64_t* physical)
+  {
+    uint64_t entry[4] = {};
+    uint64_t last_page = ~0ULL;
+
+    for (size_t i = 0; i < count; ++i) {
+      size_t const position = keys[i] & (BLOCK_SIZE - 1);
+      uint64_t const page = keys[i] >> BLOCK_BITS;
+      uint64_t const logical_addr = logical[position];
+
+      if (page != last_page) {
+        size_t level = 0;
+        if (last_page != ~0ULL) {
+          if ((page >> DIRECTORY_PREFIX_SHIFT) == (last_page >> DIRECTORY_PREFIX_SHIFT)) {
+            level = 3;
+          } else if ((page >> DIRECTORY_PTR_PREFIX_SHIFT) == (last_page >> DIRECTORY_PTR_PREFIX_SHIFT)) {
+            level = 2;
+          } else if ((page >> PLM4_PREFIX_SHIFT) == (last_page >> PLM4_PREFIX_SHIFT)) {
+            level = 1;
+          }
+        }
+
+        uint64_t table = level ? entry[level - 1] : root_address;
+        for (; level < 4; ++level) {
+          table = (level == 0 || table) ? read_entry(table, logical_addr, PAGE_LEVELS[level], memory) : 0;
+          entry[level] = table;
+        }
+        last_page = page;
+      }
+
+      physical[position] = entry[3]
+          ? part_of_logical_address(entry[3], PHYSICAL_ADDRESS_MASK) + part_of_logical_address(logical_addr, OFFSET_MASK)
+          : TRANSLATION_FAULT;
+    }
+  }
+}
+
+void translate_batch(PhysicalMemory const& memory, uint64_t const root_address,
+                     uint64_t const* logical, size_t const count, uint64_t* physical)
+{
+  std::vector<uint64_t> storage(2 * std::min(count, BLOCK_SIZE));
+  std::vector<uint32_t> histogram;
+
+  for (size_t begin = 0; begin < count; begin += BLOCK_SIZE) {
+    size_t const size = std::min(count - begin, BLOCK_SIZE);
+    uint64_t* keys = storage.data();
+    uint64_t* buffer = keys + size;
+
+    extract_keys(logical + begin, size, keys);
+    sort_keys(keys, buffer, size, histogram);
+    translate_sorted(memory, root_address, logical + begin, keys, size, physical + begin);
+  }
+}
+
+size_t format_translation(uint64_t physical, char* dst) {
+  if (physical == TRANSLATION_FAULT) {
+    std::memcpy(dst, "fault\n", 6);
+    return 6;
+  }
+
+  char digits[20];
+  size_t len = 0;
+  do {
+    digits[len++] = static_cast<char>('0' + physical % 10);
+    physical /= 10;
+  } while (physical);
+
+  for (size_t i = 0; i < len; ++i) {
+    dst[i] = digits[len - 1 - i];
+  }
+  dst[len] = '\n';
+  return len + 1;
+}
+
+void format_translations(uint64_t const* physical, size_t const count, std::string& out) {
+  size_t size = out.size();
+  out.resize(size + count * MAX_FORMATTED_TRANSLATION);
+  for (size_t i = 0; i < count; ++i) {
+    size += format_translation(physical[i], &out[size]);
+  }
+  out.resize(size);
+}
@@ -0,0 +1,76 @@
+#include <cstring>
+
+#include "../include/content_hash.h"
+
+namespace {
+  constexpr std::uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+  constexpr std::uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+  constexpr std::uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+  constexpr std::uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+  constexpr std::uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+  std::uint64_t rotl(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  std::uint64_t read64(unsigned char const* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+  }
+
+  std::uint32_t read32(unsigned char const* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+  }
+
+  std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+    return rotl(acc + input * PRIME2, 31) * PRIME1;
+  }
+
+  std::uint64_t merge_round(std::uint64_t acc, std::uint64_t lane) {
+    return (acc ^ round(0, lane)) * PRIME1 + PRIME4;
+  }
+}
+
+std::uint64_t content_hash(void const* data, size_t const size, std::uint64_t const seed) {
+  auto p = static_cast<unsigned char const*>(data);
+  unsigned char const* const end = p + size;
+  std::uint64_t hash;
+  if (size >= 32) {
+    std::uint64_t v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2, v3 = seed, v4 = seed - PRIME1;
+    for (; end - p >= 32; p += 32) {
+      v1 = round(v1, read64(p));
+      v2 = round(v2, read64(p + 8));
+      v3 = round(v3, read64(p + 16));
+      v4 = round(v4, read64(p + 24));
+    }
+    hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    hash = merge_round(hash, v1);
+    hash = merge_round(hash, v2);
+    hash = merge_round(hash, v3);
+    hash = merge_round(hash, v4);
+  } else {
+    hash = seed + PRIME5;
+  }
+  hash += size;
+
+  for (; end - p >= 8; p += 8) {
+    hash = rotl(hash ^ round(0, read64(p)), 27) * PRIME1 + PRIME4;
+  }
+  if (end - p >= 4) {
+    hash = rotl(hash ^ (read32(p) * PRIME1), 23) * PRIME2 + PRIME3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    hash = rotl(hash ^ (*p * PRIME5), 11) * PRIME1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= PRIME2;
+  hash ^= hash >> 29;
+  hash *= PRIME3;
+  hash ^= hash >> 32;
+  return hash;
+}
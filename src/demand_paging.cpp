@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+
+#include "../include/demand_paging.h"
+
+constexpr size_t PageTableArena::PAGES_PER_CHUNK;
+
+namespace {
+  // Non-present leaf entry of a page that was evicted, the OS owns the other bits of a non-present entry
+  constexpr uint64_t SWAPPED_OUT = 1ULL << 1;
+
+  // Doubly linked lists threaded through arrays indexed by frame, 'lists' sentinels follow the frames
+  class FrameLists {
+  public:
+    FrameLists(size_t frame_count, size_t lists) : m_prev(frame_count + lists), m_next(frame_count + lists),
+                                                    m_size(lists), m_frame_count(frame_count) {
+      for (size_t list = 0; list < lists; ++list) {
+        uint32_t const head = sentinel(list);
+        m_prev[head] = m_next[head] = head;
+      }
+    }
+
+    void push_back(size_t list, uint32_t frame) {
+      uint32_t const head = sentinel(list);
+      m_prev[frame] = m_prev[head];
+      m_next[frame] = head;
+      m_next[m_prev[head]] = frame;
+      m_prev[head] = frame;
+      ++m_size[list];
+    }
+
+    void remove(size_t list, uint32_t frame) {
+      m_next[m_prev[frame]] = m_next[frame];
+      m_prev[m_next[frame]] = m_prev[frame];
+      --m_size[list];
+    }
+
+    uint32_t front(size_t list) const { return m_next[sentinel(list)]; }
+    size_t size(size_t list) const { return m_size[list]; }
+
+  private:
+    uint32_t sentinel(size_t list) const { return static_cast<uint32_t>(m_frame_count + list); }
+
+    std::vector<uint32_t> m_prev;
+    std::vector<uint32_t> m_next;
+    std::vector<size_t> m_size;
+    size_t const m_frame_count;
+  };
+
+  // Frames are reused in the order they were filled, so FIFO is a hand going round the pool
+  class FifoPolicy : public ReplacementPolicy {
+  public:
+    explicit FifoPolicy(size_t frame_count) : m_frame_count(frame_count) {}
+
+    void on_hit(uint32_t) override {}
+    uint32_t victim(uint64_t) override {
+      uint32_t const frame = m_hand;
+      m_hand = static_cast<uint32_t>((m_hand + 1) % m_frame_count);
+      return frame;
+    }
+    void on_load(uint32_t, uint64_t) override {}
+
+  private:
+    size_t const m_frame_count;
+    uint32_t m_hand = 0;
+  };
+
+  class LruPolicy : public ReplacementPolicy {
+  public:
+    explicit LruPolicy(size_t frame_count) : m_lists(frame_count, 1) {}
+
+    void on_hit(uint32_t frame) override {
+      m_lists.remove(0, frame);
+      m_lists.push_back(0, frame);
+    }
+    uint32_t victim(uint64_t) override {
+      uint32_t const frame = m_lists.front(0);
+      m_lists.remove(0, frame);
+      return frame;
+    }
+    void on_load(uint32_t frame, uint64_t) override { m_lists.push_back(0, frame); }
+
+  private:
+    FrameLists m_lists;
+  };
+
+  // Second chance: the hand clears referenced bits until it finds a frame that was not used since the last pass
+  class ClockPolicy : public ReplacementPolicy {
+  public:
+    explicit ClockPolicy(size_t frame_count) : m_referenced(frame_count, 0) {}
+
+    void on_hit(uint32_t frame) override { m_referenced[frame] = 1; }
+    uint32_t victim(uint64_t) override {
+      while (m_referenced[m_hand]) {
+        m_referenced[m_hand] = 0;
+        advance();
+      }
+      uint32_t const frame = m_hand;
+      advance();
+      return frame;
+    }
+    void on_load(uint32_t frame, uint64_t) override { m_referenced[frame] = 1; }
+
+  private:
+    void advance() { m_hand = static_cast<uint32_t>((m_hand + 1) % m_referenced.size()); }
+
+    std::vector<uint8_t> m_referenced;
+    uint32_t m_hand = 0;
+  };
+
+  // ARC (Megiddo and Modha, FAST 2003). T1 holds pages seen once recently, T2 pages seen at least twice.
+  // B1 and B2 remember the pages evicted from them, a hit in a ghost list moves the target size of T1.
+  class ArcPolicy : public ReplacementPolicy {
+  public:
+    explicit ArcPolicy(size_t frame_count) : m_lists(frame_count, 2), m_page(frame_count), m_in_t2(frame_count),
+                                                m_capacity(frame_count) {}
+
+    void on_hit(uint32_t frame) override {
+      m_lists.remove(m_in_t2[frame] ? T2 : T1, frame);
+      m_lists.push_back(T2, frame);
+      m_in_t2[frame] = 1;
+    }
+
+    uint32_t victim(uint64_t page) override {
+      auto const ghost = m_ghosts.find(page);
+      if (ghost != m_ghosts.end()) {
+        bool const in_b2 = ghost->second.first == B2;
+        size_t const b1 = m_ghost_lists[B1].size(), b2 = m_ghost_lists[B2].size();
+        if (in_b2) {
+          m_target = m_target - std::min(m_target, std::max<size_t>(b1 / b2, 1));
+        } else {
+          m_target = std::min(m_capacity, m_target + std::max<size_t>(b2 / b1, 1));
+        }
+        m_ghost_lists[ghost->second.first].erase(ghost->second.second);
+        m_ghosts.erase(ghost);
+        m_load_to_t2 = true;
+        return replace(in_b2);
+      }
+
+      m_load_to_t2 = false;
+      size_t const t1 = m_lists.size(T1), b1 = m_ghost_lists[B1].size();
+      if (t1 + b1 >= m_capacity) {
+        if (t1 < m_capacity) {
+          drop_ghost(B1);
+          return replace(false);
+        }
+        uint32_t const frame = m_lists.front(T1);
+        m_lists.remove(T1, frame);
+        return frame;
+      }
+      if (t1 + b1 + m_lists.size(T2) + m_ghost_lists[B2].size() >= 2 * m_capacity) {
+        drop_ghost(B2);
+      }
+      return replace(false);
+    }
+
+    void on_load(uint32_t frame, uint64_t page) override {
+      m_page[frame] = page;
+      m_in_t2[frame] = m_load_to_t2;
+      m_lists.push_back(m_load_to_t2 ? T2 : T1, frame);
+      m_load_to_t2 = false;
+    }
+
+  private:
+    enum { T1 = 0, T2 = 1 };
+    enum { B1 = 0, B2 = 1 };
+
+    // Takes the LRU frame of T1 or T2 and remembers its page in the matching ghost list
+    uint32_t replace(bool const in_b2) {
+      size_t const t1 = m_lists.size(T1);
+      bool const from_t1 = t1 && (t1 > m_target || (in_b2 && t1 == m_target) || !m_lists.size(T2));
+      size_t const list = from_t1 ? T1 : T2;
+      uint32_t const frame = m_lists.front(list);
+      m_lists.remove(list, frame);
+
+      size_t const ghost_list = from_t1 ? B1 : B2;
+      m_ghost_lists[ghost_list].push_back(m_page[frame]);
+      m_ghosts[m_page[frame]] = std::make_pair(ghost_list, std::prev(m_ghost_lists[ghost_list].end()));
+      return frame;
+    }
+
+    void drop_ghost(size_t const ghost_list) {
+      if (m_ghost_lists[ghost_list].empty()) {
+        return;
+      }
+      m_ghosts.erase(m_ghost_lists[ghost_list].front());
+      m_ghost_lists[ghost_list].pop_front();
+    }
+
+    FrameLists m_lists;
+    std::vector<uint64_t> m_page;
+    std::vector<uint8_t> m_in_t2;
+    std::list<uint64_t> m_ghost_lists[2];
+    std::unordered_map<uint64_t, std::pair<size_t, std::list<uint64_t>::iterator>> m_ghosts;
+    size_t const m_capacity;
+    size_t m_target = 0;  // target size of T1
+    bool m_load_to_t2 = false;
+  };
+}
+
+uint32_t PageTableArena::allocate() {
+  if (m_used == m_chunks.size() * PAGES_PER_CHUNK) {
+    m_chunks.emplace_back(new uint64_t[PAGES_PER_CHUNK * PhysicalMemory::ENTRIES_PER_FRAME]());
+  }
+  uint32_t const number = static_cast<uint32_t>(m_used++);
+  if (number < m_dirty) {
+    std::memset(page(number), 0, PhysicalMemory::ENTRIES_PER_FRAME * sizeof(uint64_t));
+  }
+  return number;
+}
+
+void PageTableArena::reset() {
+  m_dirty = std::max(m_dirty, m_used);
+  m_used = 0;
+}
+
+char const* eviction_policy_name(EvictionPolicy const policy) {
+  switch (policy) {
+    case EvictionPolicy::FIFO: return "FIFO";
+    case EvictionPolicy::LRU: return "LRU";
+    case EvictionPolicy::CLOCK: return "Clock";
+    case EvictionPolicy::ARC: return "ARC";
+  }
+  return "?";
+}
+
+std::unique_ptr<ReplacementPolicy> make_replacement_policy(EvictionPolicy const policy, size_t frame_count) {
+  frame_count = std::max<size_t>(frame_count, 1);
+  switch (policy) {
+    case EvictionPolicy::FIFO: return std::unique_ptr<ReplacementPolicy>(new FifoPolicy(frame_count));
+    case EvictionPolicy::LRU: return std::unique_ptr<ReplacementPolicy>(new LruPolicy(frame_count));
+    case EvictionPolicy::CLOCK: return std::unique_ptr<ReplacementPolicy>(new ClockPolicy(frame_count));
+    case EvictionPolicy::ARC: return std::unique_ptr<ReplacementPolicy>(new ArcPolicy(frame_count));
+  }
+  return nullptr;
+}
+
+void print_paging_sim_stats(PagingSimStats const& stats, FILE* out) {
+  double const n = stats.accesses ? static_cast<double>(stats.accesses) : 1.0;
+  fprintf(out, "accesses: %llu, faults: %llu (%.3f%%, %llu cold), evictions: %llu, tables allocated: %llu\n",
+          (unsigned long long) stats.accesses, (unsigned long long) stats.faults, 100.0 * stats.faults / n,
+          (unsigned long long) stats.cold_faults, (unsigned long long) stats.evictions,
+          (unsigned long long) stats.tables_allocated);
+  fprintf(out, "entries read: %.3f per access, simulated cost: %.1f cycles per access\n",
+          stats.entries_read / n, stats.cycles / n);
+}
+
+namespace {
+  // A pool without frames has nothing to evict into, it's taken as one frame
+  PagingSimConfig clamp_config(PagingSimConfig config) {
+    config.frame_count = std::max<size_t>(config.frame_count, 1);
+    return config;
+  }
+}
+
+DemandPagingSimulator::DemandPagingSimulator(PagingSimConfig const& config) : m_config(clamp_config(config)) {
+  reset();
+}
+
+void DemandPagingSimulator::reset() {
+  m_arena.reset();
+  m_root = m_arena.allocate();
+  m_policy = make_replacement_policy(m_config.policy, m_config.frame_count);
+  m_frame_entry.assign(m_config.frame_count, nullptr);
+  m_used_frames = 0;
+  m_stats = PagingSimStats();
+  m_stats.tables_allocated = 1;
+}
+
+uint64_t* DemandPagingSimulator::leaf_entry(uint64_t const logical_addr) {
+  uint64_t* table = m_arena.page(m_root);
+  for (size_t level = 0; level < 3; ++level) {
+    uint64_t& entry = table[part_of_logical_address(logical_addr, PAGE_LEVELS[level])];
+    if (!part_of_logical_address(entry, PRESENT_BIT_MASK)) {
+      entry = ((m_config.frame_count + m_arena.allocate()) << PhysicalMemory::FRAME_SHIFT) | PRESENT_BIT_MASK.mask;
+      ++m_stats.tables_allocated;
+    }
+    table = m_arena.page(static_cast<uint32_t>(
+        (part_of_logical_address(entry, PHYSICAL_ADDRESS_MASK) >> PhysicalMemory::FRAME_SHIFT) - m_config.frame_count));
+  }
+  return &table[part_of_logical_address(logical_addr, TABLE_MASK)];
+}
+
+uint64_t DemandPagingSimulator::access(uint64_t const logical_addr) {
+  ++m_stats.accesses;
+  m_stats.entries_read += 4;
+  m_stats.cycles += 4 * m_config.entry_read_cost;
+
+  uint64_t* const entry = leaf_entry(logical_addr);
+  uint64_t frame = 0;
+  if (part_of_logical_address(*entry, PRESENT_BIT_MASK)) {
+    frame = part_of_logical_address(*entry, PHYSICAL_ADDRESS_MASK) >> PhysicalMemory::FRAME_SHIFT;
+    m_policy->on_hit(static_cast<uint32_t>(frame));
+  } else {
+    ++m_stats.faults;
+    m_stats.cycles += m_config.fault_cost;
+    if (*entry == 0) {
+      ++m_stats.cold_faults;
+    } else {
+      m_stats.cycles += m_config.page_in_cost;
+    }
+
+    uint64_t const page = part_of_logical_address(logical_addr, VIRTUAL_PAGE_MASK);
+    if (m_used_frames < m_config.frame_count) {
+      frame = m_used_frames++;
+    } else {
+      frame = m_policy->victim(page);
+      *m_frame_entry[frame] = SWAPPED_OUT;
+      ++m_stats.evictions;
+    }
+    *entry = (frame << PhysicalMemory::FRAME_SHIFT) | PRESENT_BIT_MASK.mask;
+    m_frame_entry[frame] = entry;
+    m_policy->on_load(static_cast<uint32_t>(frame), page);
+  }
+
+  return (frame << PhysicalMemory::FRAME_SHIFT) + part_of_logical_address(logical_addr, OFFSET_MASK);
+}
@@ -0,0 +1,270 @@
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+#include "../include/content_hash.h"
+#include "../include/elf_dependencies.h"
+#include "../include/elf_loader.h"
+#include "../include/fast_io.h"
+
+namespace {
+  constexpr size_t NOT_FOUND = ~size_t(0);
+
+  std::vector<std::string> split_paths(char const* list) {
+    std::vector<std::string> res;
+    for (char const* p = list;; ++p) {
+      char const* const end = std::strchr(p, ':');
+      res.emplace_back(p, end ? end : p + std::strlen(p));
+      if (!end) {
+        break;
+      }
+      p = end;
+    }
+    return res;
+  }
+
+  void parse_library(std::string const& path, LibraryInfo& info) {
+    info.path = path;
+    ElfImage image;
+    if (!image.open(path.c_str())) {
+      info.error = image.error();
+      return;
+    }
+    info.machine = image.header().e_machine;
+    LoadFootprint const footprint = compute_load_footprint(image);
+    info.mapped_bytes = footprint.mapped_pages * footprint.page_size;
+
+    elf_phdr const* dynamic = nullptr;
+    for (size_t i = 0; i < image.segment_count(); ++i) {
+      if (image.segment(i).p_type == PT_DYNAMIC) {
+        dynamic = &image.segment(i);
+      }
+    }
+    if (!dynamic) {
+      return;  // static binary
+    }
+    if (dynamic->p_offset > image.size() || dynamic->p_filesz > image.size() - dynamic->p_offset) {
+      info.error = "the dynamic segment is out of the file";
+      return;
+    }
+
+    auto const entries = reinterpret_cast<elf_dyn const*>(image.data() + dynamic->p_offset);
+    size_t const count = dynamic->p_filesz / sizeof(elf_dyn);
+    std::uint64_t strtab = 0, strsz = 0;
+    for (size_t i = 0; i < count && entries[i].d_tag != DT_NULL; ++i) {
+      if (entries[i].d_tag == DT_STRTAB) {
+        strtab = entries[i].d_val;
+      } else if (entries[i].d_tag == DT_STRSZ) {
+        strsz = entries[i].d_val;
+      }
+    }
+    char const* const strings = strsz ? image.at_address(strtab, strsz) : nullptr;
+    if (!strings) {
+      info.error = "no dynamic string table";
+      return;
+    }
+
+    for (size_t i = 0; i < count && entries[i].d_tag != DT_NULL; ++i) {
+      std::uint64_t const offset = entries[i].d_val;
+      std::int64_t const tag = entries[i].d_tag;
+      if ((tag != DT_NEEDED && tag != DT_SONAME && tag != DT_RPATH && tag != DT_RUNPATH) || offset >= strsz ||
+          !std::memchr(strings + offset, 0, strsz - offset)) {
+        continue;
+      }
+      char const* const value = strings + offset;
+      if (tag == DT_NEEDED) {
+        info.needed.emplace_back(value);
+      } else if (tag == DT_SONAME) {
+        info.soname = value;
+      } else if (tag == DT_RPATH) {
+        info.rpath = split_paths(value);
+      } else {
+        info.runpath = split_paths(value);
+      }
+    }
+  }
+
+  // Directory of the file after resolving symlinks, what $ORIGIN expands to
+  std::string origin_of(std::string const& path) {
+    char buf[PATH_MAX];
+    std::string real = realpath(path.c_str(), buf) ? buf : path;
+    size_t const slash = real.rfind('/');
+    return slash == std::string::npos ? "." : slash == 0 ? "/" : real.substr(0, slash);
+  }
+
+  std::string expand_origin(std::string dir, std::string const& origin) {
+    for (char const* token : { "${ORIGIN}", "$ORIGIN" }) {
+      size_t const len = std::strlen(token);
+      for (size_t pos = dir.find(token); pos != std::string::npos; pos = dir.find(token, pos + origin.size())) {
+        dir.replace(pos, len, origin);
+      }
+    }
+    return dir;
+  }
+}
+
+constexpr std::int64_t LibraryCache::RACY_SECONDS;
+
+std::shared_ptr<LibraryInfo const> LibraryCache::get(std::string const& path) {
+  struct stat st {};
+  if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return nullptr;
+  }
+  Identity const identity(st.st_dev, st.st_ino, static_cast<std::uint64_t>(st.st_size), st.st_mtim.tv_sec,
+                          st.st_mtim.tv_nsec, st.st_ctim.tv_sec, st.st_ctim.tv_nsec);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto const known = m_hashes.find(identity);
+    if (known != m_hashes.end() && st.st_ctim.tv_sec + RACY_SECONDS <= known->second.hashed_at) {
+      auto const it = m_libraries.find(known->second.content);
+      if (it != m_libraries.end()) {
+        ++m_hits;
+        return it->second;
+      }
+    }
+  }
+
+  // Taken before reading, so a write that lands during the hash makes the file look young
+  std::int64_t const hashed_at = static_cast<std::int64_t>(std::time(nullptr));
+  MappedFile file;
+  if (!file.open(path.c_str())) {
+    return nullptr;
+  }
+  Content const content(st.st_dev, st.st_ino, file.size(), content_hash(file.data(), file.size()));
+  file.close();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_hash_count;
+    m_hashes[identity] = KnownHash { content, hashed_at };
+    auto const it = m_libraries.find(content);
+    if (it != m_libraries.end()) {
+      ++m_hits;
+      return it->second;
+    }
+  }
+
+  // Parse outside of the lock, two threads racing for one file both parse it and the first insert wins
+  auto info = std::make_shared<LibraryInfo>();
+  parse_library(path, *info);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_parses;
+  return m_libraries.emplace(content, std::move(info)).first->second;
+}
+
+std::uint64_t LibraryCache::hits() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_hits;
+}
+
+std::uint64_t LibraryCache::parses() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_parses;
+}
+
+std::uint64_t LibraryCache::hashes() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_hash_count;
+}
+
+size_t LibraryCache::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_libraries.size();
+}
+
+bool resolve_dependencies(char const* path, LibraryCache& cache, DependencyGraph& graph,
+                          DependencyOptions const& options)
+{
+  graph = DependencyGraph();
+  std::shared_ptr<LibraryInfo const> root = cache.get(path);
+  if (!root || root->error) {
+    return false;
+  }
+  graph.nodes.push_back(DependencyNode { path, root, {} });
+  std::vector<std::string> origins = { origin_of(path) };
+  // The node that first needed each node, the loader chain of ld.so ends at the binary
+  std::vector<size_t> loaders = { NOT_FOUND };
+
+  // Loaded objects by DT_NEEDED name and soname, like the loader avoids loading a library twice
+  std::unordered_map<std::string, size_t> loaded;
+  std::vector<std::string> dirs;
+  for (size_t i = 0; i < graph.nodes.size(); ++i) {
+    std::shared_ptr<LibraryInfo const> const requester = graph.nodes[i].info;
+    for (auto const& name : requester->needed) {
+      auto const known = loaded.find(name);
+      if (known != loaded.end()) {
+        if (known->second != NOT_FOUND) {
+          graph.nodes[i].needed.push_back(known->second);
+        }
+        continue;
+      }
+
+      // DT_RPATH of the requester and of every loader up to the binary unless the requester has DT_RUNPATH,
+      // then LD_LIBRARY_PATH, DT_RUNPATH of the requester and the default directories. A loader with DT_RUNPATH
+      // contributes no DT_RPATH, each directory expands $ORIGIN of the object that names it.
+      dirs.clear();
+      auto const append = [&dirs](std::vector<std::string> const& list, std::string const& origin) {
+        for (auto const& dir : list) {
+          dirs.push_back(expand_origin(dir, origin));
+        }
+      };
+      if (name.find('/') == std::string::npos) {
+        if (requester->runpath.empty()) {
+          for (size_t loader = i; loader != NOT_FOUND; loader = loaders[loader]) {
+            LibraryInfo const& info = *graph.nodes[loader].info;
+            if (info.runpath.empty()) {
+              append(info.rpath, origins[loader]);
+            }
+          }
+        }
+        dirs.insert(dirs.end(), options.library_path.begin(), options.library_path.end());
+        append(requester->runpath, origins[i]);
+        dirs.insert(dirs.end(), options.default_paths.begin(), options.default_paths.end());
+      } else {
+        dirs.emplace_back();
+      }
+
+      std::shared_ptr<LibraryInfo const> found;
+      std::string found_path;
+      for (auto const& dir : dirs) {
+        std::string candidate = dir.empty() ? name : dir + "/" + name;
+        std::shared_ptr<LibraryInfo const> info = cache.get(candidate);
+        // Libraries of another architecture are skipped, like ld.so skips them
+        if (info && !info->error && info->machine == root->machine) {
+          found = std::move(info);
+          found_path = std::move(candidate);
+          break;
+        }
+      }
+      if (!found) {
+        graph.missing.push_back(name);
+        loaded.emplace(name, NOT_FOUND);  // reported once
+        continue;
+      }
+
+      size_t idx = graph.nodes.size();
+      for (size_t j = 0; j < graph.nodes.size(); ++j) {
+        if (graph.nodes[j].info == found) {
+          idx = j;
+          break;
+        }
+      }
+      if (idx == graph.nodes.size()) {
+        graph.nodes.push_back(DependencyNode { found_path, found, {} });
+        origins.push_back(origin_of(found_path));
+        loaders.push_back(i);
+        graph.mapped_bytes += found->mapped_bytes;
+        if (!found->soname.empty()) {
+          loaded.emplace(found->soname, idx);
+        }
+      }
+      loaded.emplace(name, idx);
+      graph.nodes[i].needed.push_back(idx);
+    }
+  }
+  graph.mapped_bytes += root->mapped_bytes;
+  return true;
+}
@@ -0,0 +1,119 @@
+#include <cstring>
+
+#include "../include/elf_image.h"
+
+namespace {
+  // Checks that [offset, offset + count * size) lies inside a file of 'file_size' bytes without overflowing
+  bool in_bounds(std::uint64_t offset, std::uint64_t count, std::uint64_t size, std::uint64_t file_size) {
+    return offset <= file_size && (size == 0 || count <= (file_size - offset) / size);
+  }
+}
+
+char const* check_elf_header(elf_hdr const& hdr, std::uint64_t const file_size) {
+  if (hdr.e_ident[0] != 0x7f || hdr.e_ident[1] != 'E' || hdr.e_ident[2] != 'L' || hdr.e_ident[3] != 'F') {
+    return "not an ELF file";
+  }
+  if (hdr.e_ident[EI_CLASS] != ELFCLASS64 || hdr.e_ident[EI_DATA] != ELFDATA2LSB) {
+    return "not a 64-bit little-endian ELF file";
+  }
+  if (hdr.e_phnum) {
+    if (hdr.e_phentsize < sizeof(elf_phdr)) {
+      return "program header entries are too small";
+    }
+    if (!in_bounds(hdr.e_phoff, hdr.e_phnum, hdr.e_phentsize, file_size)) {
+      return "the program header table is out of the file";
+    }
+  }
+  if (hdr.e_shnum) {
+    if (hdr.e_shentsize < sizeof(elf_shdr)) {
+      return "section header entries are too small";
+    }
+    if (!in_bounds(hdr.e_shoff, hdr.e_shnum, hdr.e_shentsize, file_size)) {
+      return "the section header table is out of the file";
+    }
+  }
+  return nullptr;
+}
+
+bool ElfImage::fail(char const* error) {
+  m_error = error;
+  m_section_count = 0;
+  m_file.close();
+  return false;
+}
+
+bool ElfImage::open(char const* path) {
+  m_error = "";
+  m_section_count = 0;
+  if (!m_file.open(path)) {
+    return fail("can't open the file");
+  }
+  if (m_file.size() < sizeof(elf_hdr)) {
+    return fail("the file is smaller than the ELF header");
+  }
+
+  char const* const error = check_elf_header(header(), m_file.size());
+  if (error) {
+    return fail(error);
+  }
+  m_section_count = header().e_shnum;
+  return true;
+}
+
+void ElfImage::close() {
+  m_section_count = 0;
+  m_file.close();
+}
+
+std::uint64_t ElfImage::load_size() const {
+  std::uint64_t res = 0;
+  for (std::size_t i = 0; i < segment_count(); ++i) {
+    if (segment(i).p_type == PT_LOAD) {
+      res += segment(i).p_memsz;
+    }
+  }
+  return res;
+}
+
+char const* ElfImage::at_address(std::uint64_t const vaddr, std::uint64_t const size) const {
+  for (std::size_t i = 0; i < segment_count(); ++i) {
+    elf_phdr const& phdr = segment(i);
+    if (phdr.p_type != PT_LOAD || vaddr < phdr.p_vaddr || vaddr - phdr.p_vaddr > phdr.p_filesz ||
+        size > phdr.p_filesz - (vaddr - phdr.p_vaddr)) {
+      continue;
+    }
+    std::uint64_t const offset = phdr.p_offset + (vaddr - phdr.p_vaddr);
+    return in_bounds(offset, size, 1, m_file.size()) ? m_file.data() + offset : nullptr;
+  }
+  return nullptr;
+}
+
+char const* ElfImage::section_data(elf_shdr const& shdr) const {
+  if (shdr.sh_type == SHT_NOBITS || !in_bounds(shdr.sh_offset, shdr.sh_size, 1, m_file.size())) {
+    return nullptr;
+  }
+  return m_file.data() + shdr.sh_offset;
+}
+
+char const* ElfImage::section_name(std::size_t const idx) const {
+  std::size_t const strndx = header().e_shstrndx;
+  if (idx >= m_section_count || strndx >= m_section_count) {
+    return "";
+  }
+  elf_shdr const& strtab = section(strndx);
+  char const* const names = section_data(strtab);
+  std::uint64_t const name = section(idx).sh_name;
+  if (!names || name >= strtab.sh_size || !std::memchr(names + name, 0, strtab.sh_size - name)) {
+    return "";
+  }
+  return names + name;
+}
+
+elf_shdr const* ElfImage::find_section(std::uint32_t const type) const {
+  for (std::size_t i = 0; i < m_section_count; ++i) {
+    if (section(i).sh_type == type) {
+      return &section(i);
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../include/elf_loader.h"
+
+namespace {
+  std::uint64_t round_down(std::uint64_t value, std::uint64_t alignment) {
+    return value / alignment * alignment;
+  }
+
+  std::uint64_t round_up(std::uint64_t value, std::uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  int protection(std::uint32_t flags) {
+    return ((flags & PF_R) ? PROT_READ : 0) | ((flags & PF_W) ? PROT_WRITE : 0) | ((flags & PF_X) ? PROT_EXEC : 0);
+  }
+}
+
+LoadFootprint compute_load_footprint(std::vector<elf_phdr> const& loads, std::uint64_t page_size) {
+  LoadFootprint res;
+  res.page_size = page_size ? page_size : static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+  res.align = res.page_size;
+  std::uint64_t const page = res.page_size;
+
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> ranges;
+  for (auto const& phdr : loads) {
+    if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0) {
+      continue;
+    }
+    SegmentLayout layout;
+    layout.phdr = phdr;
+    layout.page_start = round_down(phdr.p_vaddr, page);
+    layout.page_end = round_up(phdr.p_vaddr + phdr.p_memsz, page);
+    std::uint64_t const file_end = round_up(phdr.p_vaddr + std::min(phdr.p_filesz, phdr.p_memsz), page);
+    layout.file_pages = phdr.p_filesz ? (file_end - layout.page_start) / page : 0;
+    layout.bss_pages = (layout.page_end - layout.page_start) / page - layout.file_pages;
+    layout.bss_bytes = phdr.p_memsz > phdr.p_filesz ? phdr.p_memsz - phdr.p_filesz : 0;
+
+    res.align = std::max(res.align, phdr.p_align);
+    res.file_pages += layout.file_pages;
+    res.bss_pages += layout.bss_pages;
+    res.naive_size += phdr.p_memsz;
+    ranges.emplace_back(layout.page_start, layout.page_end);
+    res.segments.push_back(layout);
+  }
+  if (ranges.empty()) {
+    return res;
+  }
+
+  std::sort(ranges.begin(), ranges.end());
+  res.span_start = ranges.front().first;
+  std::uint64_t covered_start = ranges.front().first, covered_end = ranges.front().second;
+  for (auto const& range : ranges) {
+    if (range.first > covered_end) {
+      res.mapped_pages += (covered_end - covered_start) / page;
+      covered_start = range.first;
+    }
+    covered_end = std::max(covered_end, range.second);
+  }
+  res.mapped_pages += (covered_end - covered_start) / page;
+  res.span_end = covered_end;
+  res.span_pages = (res.span_end - res.span_start) / page;
+  res.gap_pages = res.span_pages - res.mapped_pages;
+
+  // Pages under two or more segments: a sweep over the range boundaries, ends before starts at one address
+  std::vector<std::pair<std::uint64_t, int>> bounds;
+  for (auto const& range : ranges) {
+    bounds.emplace_back(range.first, 1);
+    bounds.emplace_back(range.second, -1);
+  }
+  std::sort(bounds.begin(), bounds.end());
+  int depth = 0;
+  for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+    depth += bounds[i].second;
+    if (depth > 1) {
+      res.overlap_pages += (bounds[i + 1].first - bounds[i].first) / page;
+    }
+  }
+  return res;
+}
+
+LoadFootprint compute_load_footprint(ElfImage const& image, std::uint64_t const page_size) {
+  std::vector<elf_phdr> loads;
+  for (std::size_t i = 0; i < image.segment_count(); ++i) {
+    if (image.segment(i).p_type == PT_LOAD) {
+      loads.push_back(image.segment(i));
+    }
+  }
+  return compute_load_footprint(loads, page_size);
+}
+
+void segment_permissions(std::uint32_t const flags, char out[4]) {
+  out[0] = (flags & PF_R) ? 'r' : '-';
+  out[1] = (flags & PF_W) ? 'w' : '-';
+  out[2] = (flags & PF_X) ? 'x' : '-';
+  out[3] = 0;
+}
+
+SegmentLoader::~SegmentLoader() {
+  unload();
+}
+
+bool SegmentLoader::fail(char const* error) {
+  m_error = error;
+  unload();
+  return false;
+}
+
+void SegmentLoader::unload() {
+  if (m_reservation) {
+    munmap(m_reservation, m_reservation_size);
+  }
+  m_reservation = nullptr;
+  m_reservation_size = 0;
+  m_base = nullptr;
+  m_bias = 0;
+}
+
+bool SegmentLoader::load(char const* path) {
+  unload();
+  m_error = "";
+  {
+    ElfImage image;
+    if (!image.open(path)) {
+      return fail(image.error());
+    }
+    m_footprint = compute_load_footprint(image);
+    for (auto const& segment : m_footprint.segments) {
+      if (segment.phdr.p_offset > image.size() || segment.phdr.p_filesz > image.size() - segment.phdr.p_offset) {
+        return fail("a segment is out of the file");
+      }
+    }
+  }
+  LoadFootprint const& fp = m_footprint;
+  if (fp.segments.empty()) {
+    return fail("no PT_LOAD segments");
+  }
+  std::uint64_t const page = fp.page_size;
+  for (auto const& segment : fp.segments) {
+    if (segment.phdr.p_vaddr % page != segment.phdr.p_offset % page) {
+      return fail("segment offset and address disagree modulo the page size");
+    }
+  }
+
+  // Over-reserve so the span can start on a p_align boundary, like ld.so does for PIE and shared objects
+  std::uint64_t const span = fp.span_end - fp.span_start;
+  std::uint64_t const slack = fp.align > page ? fp.align - page : 0;
+  m_reservation_size = span + slack;
+  void* const reservation = mmap(nullptr, m_reservation_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                                 -1, 0);
+  if (reservation == MAP_FAILED) {
+    m_reservation_size = 0;
+    return fail("can't reserve the address span");
+  }
+  m_reservation = static_cast<char*>(reservation);
+  m_base = reinterpret_cast<char*>(round_up(reinterpret_cast<std::uint64_t>(m_reservation), fp.align));
+  m_bias = reinterpret_cast<std::uint64_t>(m_base) - fp.span_start;
+
+  int const fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return fail("can't open the file");
+  }
+  for (auto const& segment : fp.segments) {
+    elf_phdr const& phdr = segment.phdr;
+    int const prot = protection(phdr.p_flags);
+    char* const start = reinterpret_cast<char*>(m_bias + segment.page_start);
+    std::uint64_t const file_size = segment.file_pages * page;
+    std::uint64_t const file_end = phdr.p_vaddr + std::min(phdr.p_filesz, phdr.p_memsz);
+    // The tail of the last file page past p_filesz belongs to BSS and has to read as zeros
+    bool const zero_tail = phdr.p_memsz > phdr.p_filesz && file_end % page != 0;
+
+    if (file_size) {
+      void* const addr = mmap(start, file_size, prot | (zero_tail ? PROT_WRITE : 0), MAP_PRIVATE | MAP_FIXED, fd,
+                              static_cast<off_t>(round_down(phdr.p_offset, page)));
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        return fail("can't map a segment");
+      }
+      if (zero_tail) {
+        char* const tail = reinterpret_cast<char*>(m_bias + file_end);
+        std::memset(tail, 0, page - file_end % page);
+        if (!(prot & PROT_WRITE)) {
+          mprotect(start, file_size, prot);
+        }
+      }
+    }
+    if (segment.bss_pages) {
+      void* const addr = mmap(start + file_size, segment.bss_pages * page, prot,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        return fail("can't map BSS");
+      }
+    }
+  }
+  ::close(fd);
+  return true;
+}
+
+std::uint64_t SegmentLoader::touch() const {
+  std::uint64_t touched = 0;
+  for (auto const& segment : m_footprint.segments) {
+    if (!(segment.phdr.p_flags & PF_R)) {
+      continue;
+    }
+    for (std::uint64_t addr = segment.page_start; addr < segment.page_end; addr += m_footprint.page_size) {
+      char const value = *reinterpret_cast<char const volatile*>(m_bias + addr);
+      (void) value;
+      ++touched;
+    }
+  }
+  return touched;
+}
+
+std::uint64_t process_rss() {
+  FILE* const statm = std::fopen("/proc/self/statm", "r");
+  if (!statm) {
+    return 0;
+  }
+  unsigned long long size = 0, resident = 0;
+  int const read = std::fscanf(statm, "%llu %llu", &size, &resident);
+  std::fclose(statm);
+  return read == 2 ? resident * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
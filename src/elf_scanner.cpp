@@ -0,0 +1,293 @@
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/elf_scanner.h"
+
+namespace {
+  // Program header tables are a few KiB, anything bigger than this is treated as a broken header
+  constexpr std::uint64_t MAX_PHDR_TABLE = 1 << 20;
+
+  struct ScanState {
+    std::mutex mutex;
+    std::condition_variable work_ready;  // a path was queued or the walk ended
+    std::condition_variable slot_free;   // a path was taken by a worker
+    std::deque<std::string> paths;
+    bool walk_done = false;
+
+    std::mutex sink_mutex;
+  };
+
+  ssize_t read_at(int fd, void* buf, size_t size, std::uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+      ssize_t const n = pread(fd, static_cast<char*>(buf) + done, size - done, static_cast<off_t>(offset + done));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      done += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(done);
+  }
+
+  // Returns false for files that are not ELF, 'stats' tells unreadable and broken files apart
+  bool scan_file(std::string const& path, ElfScanResult& result, std::vector<char>& table, ElfScanStats& stats) {
+    int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      ++stats.errors;
+      return false;
+    }
+    struct stat st {};
+    elf_hdr hdr {};
+    ssize_t const n = fstat(fd, &st) == 0 ? read_at(fd, &hdr, sizeof(hdr), 0) : -1;
+    if (n < 0) {
+      ++stats.errors;
+      ::close(fd);
+      return false;
+    }
+    stats.bytes_read += static_cast<std::uint64_t>(n);
+    if (n < 4 || std::memcmp(hdr.e_ident, "\x7f" "ELF", 4) != 0) {
+      ::close(fd);
+      return false;
+    }
+
+    ++stats.elf_files;
+    std::uint64_t const table_size = std::uint64_t(hdr.e_phnum) * hdr.e_phentsize;
+    if (static_cast<size_t>(n) < sizeof(hdr) || check_elf_header(hdr, static_cast<std::uint64_t>(st.st_size)) ||
+        table_size > MAX_PHDR_TABLE) {
+      ++stats.errors;
+      ::close(fd);
+      return false;
+    }
+    table.resize(table_size);
+    ssize_t const m = read_at(fd, table.data(), table_size, hdr.e_phoff);
+    ::close(fd);
+    if (m >= 0) {
+      stats.bytes_read += static_cast<std::uint64_t>(m);
+    }
+    if (m != static_cast<ssize_t>(table_size)) {
+      ++stats.errors;
+      return false;
+    }
+
+    result.path = path;
+    result.file_size = static_cast<std::uint64_t>(st.st_size);
+    result.type = hdr.e_type;
+    result.machine = hdr.e_machine;
+    result.entry = hdr.e_entry;
+    result.load_size = 0;
+    result.loads.clear();
+    for (size_t i = 0; i < hdr.e_phnum; ++i) {
+      elf_phdr phdr;
+      std::memcpy(&phdr, table.data() + i * hdr.e_phentsize, sizeof(phdr));
+      if (phdr.p_type == PT_LOAD) {
+        result.load_size += phdr.p_memsz;
+        result.loads.push_back(phdr);
+      }
+    }
+    return true;
+  }
+
+  // Queues the regular files under 'dir', waits while the queue is full
+  void walk(std::string const& dir, ScanState& state, size_t const max_in_flight, ElfScanStats& stats) {
+    DIR* const handle = opendir(dir.c_str());
+    if (!handle) {
+      return;
+    }
+    std::string path = dir;
+    if (path.empty() || path.back() != '/') {
+      path += '/';
+    }
+    size_t const prefix = path.size();
+
+    while (dirent const* entry = readdir(handle)) {
+      if (std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0) {
+        continue;
+      }
+      path.resize(prefix);
+      path += entry->d_name;
+
+      unsigned char type = entry->d_type;
+      if (type == DT_UNKNOWN) {
+        struct stat st {};
+        if (lstat(path.c_str(), &st) != 0) {
+          continue;
+        }
+        type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_LNK;
+      }
+
+      if (type == DT_DIR) {
+        walk(path, state, max_in_flight, stats);
+      } else if (type == DT_REG) {
+        ++stats.files;
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.slot_free.wait(lock, [&]() { return state.paths.size() < max_in_flight; });
+        state.paths.push_back(path);
+        state.work_ready.notify_one();
+      }
+    }
+    closedir(handle);
+  }
+
+  void append_segment_flags(std::uint32_t const flags, std::string& out) {
+    out += (flags & PF_R) ? 'r' : '-';
+    out += (flags & PF_W) ? 'w' : '-';
+    out += (flags & PF_X) ? 'x' : '-';
+  }
+
+  void append_number(char const* format, std::uint64_t const value, std::string& out) {
+    char buf[32];
+    int const len = snprintf(buf, sizeof(buf), format, static_cast<unsigned long long>(value));
+    out.append(buf, static_cast<size_t>(len));
+  }
+
+  void append_csv_field(std::string const& value, std::string& out) {
+    if (value.find_first_of(",\"\n\r") == std::string::npos) {
+      out += value;
+      return;
+    }
+    out += '"';
+    for (char c : value) {
+      if (c == '"') {
+        out += '"';
+      }
+      out += c;
+    }
+    out += '"';
+  }
+
+  void append_json_string(std::string const& value, std::string& out) {
+    out += '"';
+    for (unsigned char c : value) {
+      if (c == '"' || c == '\\') {
+        out += '\\';
+        out += static_cast<char>(c);
+      } else if (c < 0x20) {
+        append_number("\\u%04llx", c, out);
+      } else {
+        out += static_cast<char>(c);
+      }
+    }
+    out += '"';
+  }
+}
+
+ElfScanStats scan_elf_tree(char const* root, ElfScanSink const& sink, ElfScanOptions const& options) {
+  auto const start = std::chrono::steady_clock::now();
+  size_t workers = options.workers ? options.workers : std::thread::hardware_concurrency();
+  workers = workers ? workers : 1;
+  size_t const max_in_flight = options.max_in_flight ? options.max_in_flight : 256 * workers;
+
+  ScanState state;
+  std::vector<ElfScanStats> worker_stats(workers);
+  std::vector<std::thread> pool;
+  for (size_t i = 0; i < workers; ++i) {
+    pool.emplace_back([&, i]() {
+      ElfScanResult result;
+      std::vector<char> table;
+      for (;;) {
+        std::string path;
+        {
+          std::unique_lock<std::mutex> lock(state.mutex);
+          state.work_ready.wait(lock, [&]() { return !state.paths.empty() || state.walk_done; });
+          if (state.paths.empty()) {
+            return;
+          }
+          path.swap(state.paths.front());
+          state.paths.pop_front();
+          state.slot_free.notify_one();
+        }
+
+        if (scan_file(path, result, table, worker_stats[i])) {
+          std::lock_guard<std::mutex> lock(state.sink_mutex);
+          sink(result);
+        }
+      }
+    });
+  }
+
+  ElfScanStats stats;
+  struct stat st {};
+  if (stat(root, &st) == 0 && S_ISREG(st.st_mode)) {
+    ++stats.files;
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.paths.push_back(root);
+  } else {
+    walk(root, state, max_in_flight, stats);
+  }
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.walk_done = true;
+    state.work_ready.notify_all();
+  }
+  for (auto& thread : pool) {
+    thread.join();
+  }
+
+  for (auto const& local : worker_stats) {
+    stats.elf_files += local.elf_files;
+    stats.errors += local.errors;
+    stats.bytes_read += local.bytes_read;
+  }
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
+
+char const* elf_scan_header(ElfScanFormat const format) {
+  return format == ElfScanFormat::CSV ? "path,file_size,type,machine,entry,load_size,segments\n" : "";
+}
+
+void format_elf_scan_result(ElfScanResult const& result, ElfScanFormat const format, std::string& out) {
+  if (format == ElfScanFormat::CSV) {
+    // Segments are "flags@vaddr+memsz" separated by spaces
+    append_csv_field(result.path, out);
+    append_number(",%llu", result.file_size, out);
+    append_number(",%llu", result.type, out);
+    append_number(",%llu", result.machine, out);
+    append_number(",0x%llx", result.entry, out);
+    append_number(",%llu,", result.load_size, out);
+    for (size_t i = 0; i < result.loads.size(); ++i) {
+      if (i) {
+        out += ' ';
+      }
+      append_segment_flags(result.loads[i].p_flags, out);
+      append_number("@0x%llx", result.loads[i].p_vaddr, out);
+      append_number("+0x%llx", result.loads[i].p_memsz, out);
+    }
+    out += '\n';
+    return;
+  }
+
+  out += "{\"path\":";
+  append_json_string(result.path, out);
+  append_number(",\"file_size\":%llu", result.file_size, out);
+  append_number(",\"type\":%llu", result.type, out);
+  append_number(",\"machine\":%llu", result.machine, out);
+  append_number(",\"entry\":%llu", result.entry, out);
+  append_number(",\"load_size\":%llu", result.load_size, out);
+  out += ",\"segments\":[";
+  for (size_t i = 0; i < result.loads.size(); ++i) {
+    elf_phdr const& load = result.loads[i];
+    out += i ? ",{\"flags\":\"" : "{\"flags\":\"";
+    append_segment_flags(load.p_flags, out);
+    append_number("\",\"offset\":%llu", load.p_offset, out);
+    append_number(",\"vaddr\":%llu", load.p_vaddr, out);
+    append_number(",\"filesz\":%llu", load.p_filesz, out);
+    append_number(",\"memsz\":%llu", load.p_memsz, out);
+    append_number(",\"align\":%llu}", load.p_align, out);
+  }
+  out += "]}\n";
+}
@@ -0,0 +1,130 @@
+#include <fstream>
+
+#include "../include/fast_io.h"
+
+#ifdef _WINDOWS
+  #include <fcntl.h>
+  #include <io.h>
+
+  namespace {
+    int open_for_write(char const* path) {
+      return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+    }
+    long long write_fd(int fd, char const* data, size_t size) {
+      return _write(fd, data, static_cast<unsigned>(size));
+    }
+    void close_fd(int fd) {
+      _close(fd);
+    }
+  }
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+
+  namespace {
+    int open_for_write(char const* path) {
+      return ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    long long write_fd(int fd, char const* data, size_t size) {
+      return ::write(fd, data, size);
+    }
+    void close_fd(int fd) {
+      ::close(fd);
+    }
+  }
+#endif
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+bool MappedFile::open(char const* path) {
+  close();
+#ifndef _WINDOWS
+  int const fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st {};
+  bool const have_size = fstat(fd, &st) == 0;
+  if (have_size && st.st_size > 0) {
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+      m_data = static_cast<char const*>(addr);
+      m_size = static_cast<size_t>(st.st_size);
+      m_mapped = true;
+    }
+  }
+  ::close(fd);
+  if (m_mapped || (have_size && st.st_size == 0)) {
+    return true;
+  }
+#endif
+  // Fallback for files that can't be mapped or whose size fstat can't tell
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return false;
+  }
+  m_buffer.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0, std::ios::beg);
+  if (!file.read(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()))) {
+    m_buffer.clear();
+    return false;
+  }
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+  return true;
+}
+
+void MappedFile::close() {
+#ifndef _WINDOWS
+  if (m_mapped) {
+    munmap(const_cast<char*>(m_data), m_size);
+  }
+#endif
+  m_buffer.clear();
+  m_data = nullptr;
+  m_size = 0;
+  m_mapped = false;
+}
+
+BufferedWriter::~BufferedWriter() {
+  close();
+}
+
+bool BufferedWriter::open(char const* path) {
+  close();
+  m_fd = open_for_write(path);
+  m_failed = false;
+  return m_fd >= 0;
+}
+
+bool BufferedWriter::close() {
+  if (m_fd < 0) {
+    return !m_failed;
+  }
+  flush();
+  close_fd(m_fd);
+  m_fd = -1;
+  return !m_failed;
+}
+
+void BufferedWriter::flush() {
+  write_out(m_buffer.data(), m_size);
+  m_size = 0;
+}
+
+void BufferedWriter::write_out(char const* data, size_t size) {
+  while (size > 0 && m_fd >= 0) {
+    long long const written = write_fd(m_fd, data, size);
+    if (written <= 0) {
+      m_failed = true;
+      return;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+}
@@ -0,0 +1,181 @@
+#include <cstddef>
+
+#include "../include/page_table_snapshot.h"
+
+namespace {
+  constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+  constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+  constexpr uint64_t TABLES_ALIGNMENT = 1ULL << PhysicalMemory::FRAME_SHIFT;
+
+  uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  uint64_t checksum_update(uint64_t hash, void const* data, size_t size) {
+    auto bytes = static_cast<unsigned char const*>(data);
+    for (; size >= 8; size -= 8, bytes += 8) {
+      uint64_t word;
+      std::memcpy(&word, bytes, 8);
+      hash = (hash ^ word) * FNV_PRIME;
+    }
+    if (size) {
+      uint64_t word = 0;
+      std::memcpy(&word, bytes, size);
+      hash = (hash ^ word) * FNV_PRIME;
+    }
+    return hash;
+  }
+
+  uint64_t header_checksum(SnapshotHeader const& header) {
+    return snapshot_checksum(&header, offsetof(SnapshotHeader, header_checksum));
+  }
+
+  // Checks that [offset, offset + count * size) lies inside the file
+  bool in_bounds(uint64_t offset, uint64_t count, uint64_t size, uint64_t file_size) {
+    return offset <= file_size && count <= (file_size - offset) / size;
+  }
+}
+
+uint64_t snapshot_checksum(void const* data, size_t size) {
+  return checksum_update(FNV_OFFSET, data, size);
+}
+
+bool write_snapshot(PhysicalMemory const& memory, uint64_t const root_address, char const* path) {
+  static char const zeros[TABLES_ALIGNMENT] = {};
+
+  SnapshotHeader header {};
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.header_size = sizeof(SnapshotHeader);
+  header.root_address = root_address;
+  // An empty image has no index, it gets the smallest one open() accepts: two empty slots
+  static uint32_t const empty_index[2] = { PhysicalMemory::EMPTY_SLOT, PhysicalMemory::EMPTY_SLOT };
+  uint32_t const* index = memory.frame_count() ? memory.index() : empty_index;
+  header.frame_count = memory.frame_count();
+  header.index_capacity = memory.frame_count() ? memory.index_capacity() : 2;
+  header.frames_offset = align_up(sizeof(SnapshotHeader), sizeof(uint64_t));
+  header.index_offset = header.frames_offset + header.frame_count * sizeof(uint64_t);
+  header.tables_offset = align_up(header.index_offset + header.index_capacity * sizeof(uint32_t), TABLES_ALIGNMENT);
+  uint64_t const tables_size = header.frame_count * PhysicalMemory::ENTRIES_PER_FRAME * sizeof(uint64_t);
+  header.file_size = header.tables_offset + tables_size;
+
+  size_t const frames_padding = header.frames_offset - sizeof(SnapshotHeader);
+  size_t const index_padding = header.tables_offset - header.index_offset - header.index_capacity * sizeof(uint32_t);
+  uint64_t hash = FNV_OFFSET;
+  hash = checksum_update(hash, zeros, frames_padding);
+  hash = checksum_update(hash, memory.frames(), header.frame_count * sizeof(uint64_t));
+  hash = checksum_update(hash, index, header.index_capacity * sizeof(uint32_t));
+  hash = checksum_update(hash, zeros, index_padding);
+  hash = checksum_update(hash, memory.tables(), tables_size);
+  header.data_checksum = hash;
+  header.header_checksum = header_checksum(header);
+
+  BufferedWriter out;
+  if (!out.open(path)) {
+    return false;
+  }
+  out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  out.write(zeros, frames_padding);
+  out.write(reinterpret_cast<char const*>(memory.frames()), header.frame_count * sizeof(uint64_t));
+  out.write(reinterpret_cast<char const*>(index), header.index_capacity * sizeof(uint32_t));
+  out.write(zeros, index_padding);
+  out.write(reinterpret_cast<char const*>(memory.tables()), tables_size);
+  return out.close();
+}
+
+bool convert_dump_to_snapshot(char const* dump_path, char const* snapshot_path) {
+  MappedFile in;
+  if (!in.open(dump_path)) {
+    return false;
+  }
+  NumberParser parser(in.data(), in.data() + in.size());
+  uint64_t table_size = 0, query_count = 0, root_address = 0;
+  if (!parser.next(table_size) || !parser.next(query_count) || !parser.next(root_address)) {
+    return false;
+  }
+
+  std::vector<std::pair<uint64_t, uint64_t>> entries(table_size);
+  for (auto& entry : entries) {
+    if (!parser.next(entry.first) || !parser.next(entry.second)) {
+      return false;
+    }
+  }
+  in.close();
+
+  PhysicalMemory memory;
+  memory.build(std::move(entries));
+  return write_snapshot(memory, root_address, snapshot_path);
+}
+
+bool PageTableSnapshot::fail(char const* error) {
+  m_error = error;
+  m_memory.attach(nullptr, 0, nullptr, nullptr, 2);
+  m_file.close();
+  return false;
+}
+
+bool PageTableSnapshot::open(char const* path, bool const verify_data) {
+  m_error = "";
+  if (!m_file.open(path)) {
+    return fail("can't open the file");
+  }
+
+  SnapshotHeader header {};
+  uint64_t const file_size = m_file.size();
+  if (file_size < sizeof(header)) {
+    return fail("the file is smaller than the header");
+  }
+  std::memcpy(&header, m_file.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+    return fail("not a page-table snapshot");
+  }
+  if (header.version != SNAPSHOT_VERSION || header.header_size != sizeof(SnapshotHeader)) {
+    return fail("unsupported snapshot version");
+  }
+  if (header.header_checksum != header_checksum(header)) {
+    return fail("header checksum mismatch");
+  }
+  if (header.file_size != file_size) {
+    return fail("the file is truncated");
+  }
+
+  bool const index_ok = header.index_capacity >= 2 && (header.index_capacity & (header.index_capacity - 1)) == 0 &&
+                        header.frame_count < header.index_capacity && header.frame_count < PhysicalMemory::EMPTY_SLOT;
+  bool const layout_ok = header.frames_offset % sizeof(uint64_t) == 0 && header.index_offset % sizeof(uint32_t) == 0 &&
+                         header.tables_offset % TABLES_ALIGNMENT == 0 &&
+                         in_bounds(header.frames_offset, header.frame_count, sizeof(uint64_t), file_size) &&
+                         in_bounds(header.index_offset, header.index_capacity, sizeof(uint32_t), file_size) &&
+                         in_bounds(header.tables_offset, header.frame_count,
+                                   PhysicalMemory::ENTRIES_PER_FRAME * sizeof(uint64_t), file_size);
+  if (!index_ok || !layout_ok) {
+    return fail("corrupted layout");
+  }
+
+  if (verify_data &&
+      header.data_checksum != snapshot_checksum(m_file.data() + sizeof(header), file_size - sizeof(header))) {
+    return fail("data checksum mismatch");
+  }
+
+  // Lookups trust the index: a slot past the frames would read outside the file, and an index without an empty
+  // slot would make a lookup of an absent frame probe forever. Reading it costs far less than the tables.
+  char const* base = m_file.data();
+  uint32_t const* index = reinterpret_cast<uint32_t const*>(base + header.index_offset);
+  bool has_empty_slot = false;
+  for (uint64_t slot = 0; slot < header.index_capacity; ++slot) {
+    if (index[slot] == PhysicalMemory::EMPTY_SLOT) {
+      has_empty_slot = true;
+    } else if (index[slot] >= header.frame_count) {
+      return fail("corrupted index");
+    }
+  }
+  if (!has_empty_slot) {
+    return fail("corrupted index");
+  }
+
+  m_root_address = header.root_address;
+  m_memory.attach(reinterpret_cast<uint64_t const*>(base + header.frames_offset), header.frame_count,
+                  reinterpret_cast<uint64_t const*>(base + header.tables_offset),
+                  index, header.index_capacity);
+  return true;
+}
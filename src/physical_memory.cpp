@@ -0,0 +1,81 @@
+#include <algorithm>
+
+#include "../include/mapping.h"
+
+constexpr uint64_t PhysicalMemory::FRAME_SHIFT;
+constexpr uint64_t PhysicalMemory::ENTRIES_PER_FRAME;
+constexpr uint32_t PhysicalMemory::EMPTY_SLOT;
+
+void PhysicalMemory::build(std::vector<std::pair<uint64_t, uint64_t>> entries) {
+  std::vector<uint64_t> frames;
+  std::vector<uint64_t> tables;
+  std::vector<uint32_t> index;
+
+  // Stable sort keeps the order of duplicates, so the last value written for an address wins
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](std::pair<uint64_t, uint64_t> const& a, std::pair<uint64_t, uint64_t> const& b) {
+                     return a.first < b.first;
+                   });
+
+  for (auto const& entry : entries) {
+    uint64_t const frame_number = entry.first >> FRAME_SHIFT;
+    if ((entry.first & 7) == 0 && (frames.empty() || frames.back() != frame_number)) {
+      frames.push_back(frame_number);
+    }
+  }
+
+  tables.assign(frames.size() * ENTRIES_PER_FRAME, 0);
+  size_t idx = 0;
+  for (auto const& entry : entries) {
+    if (entry.first & 7) {
+      continue;
+    }
+    uint64_t const frame_number = entry.first >> FRAME_SHIFT;
+    while (frames[idx] != frame_number) {
+      ++idx;
+    }
+    tables[idx * ENTRIES_PER_FRAME + ((entry.first & OFFSET_MASK.mask) >> 3)] = entry.second;
+  }
+
+  // Keep the load factor of the index at or below 1/2 so that a miss stops after a couple of probes
+  uint32_t bits = 1;
+  while ((1ULL << bits) < frames.size() * 2) {
+    ++bits;
+  }
+  uint32_t const hash_shift = 64 - bits;
+  uint64_t const index_mask = (1ULL << bits) - 1;
+  index.assign(1ULL << bits, EMPTY_SLOT);
+  for (size_t i = 0; i < frames.size(); ++i) {
+    uint64_t slot = hash(frames[i], hash_shift);
+    while (index[slot] != EMPTY_SLOT) {
+      slot = (slot + 1) & index_mask;
+    }
+    index[slot] = static_cast<uint32_t>(i);
+  }
+
+  m_frames_storage.swap(frames);
+  m_tables_storage.swap(tables);
+  m_index_storage.swap(index);
+  attach(m_frames_storage.data(), m_frames_storage.size(), m_tables_storage.data(),
+         m_index_storage.data(), m_index_storage.size());
+}
+
+void PhysicalMemory::attach(uint64_t const* frames, size_t const frame_count, uint64_t const* tables,
+                            uint32_t const* index, size_t const index_capacity)
+{
+  if (frames != m_frames_storage.data()) {
+    m_frames_storage.clear();
+    m_tables_storage.clear();
+    m_index_storage.clear();
+  }
+
+  m_frames = frames;
+  m_tables = tables;
+  m_index = index;
+  m_frame_count = frame_count;
+  m_index_mask = index_capacity - 1;
+  m_hash_shift = 64;
+  for (size_t capacity = index_capacity; capacity > 1; capacity /= 2) {
+    --m_hash_shift;
+  }
+}
@@ -0,0 +1,156 @@
+#include <algorithm>
+
+#include "../include/reverse_mapping.h"
+
+constexpr uint64_t ReverseMapping::PAGE_SHIFTS[ReverseMapping::PAGE_SIZES];
+constexpr uint32_t ReverseMapping::NOT_VISITED;
+
+ReverseMapping::ReverseMapping(PhysicalMemory const& memory, uint64_t const root_address, PagingMode const& mode) :
+    m_memory(memory), m_root_address(root_address), m_mode(mode) {}
+
+void ReverseMapping::build() const {
+  std::vector<uint32_t> visited(m_memory.frame_count() * m_mode.depth(), NOT_VISITED);
+  enumerate(m_root_address, 0, Parent { NOT_VISITED, 0 }, visited);
+  for (auto& pages : m_pages) {
+    std::sort(pages.begin(), pages.end());
+    pages.shrink_to_fit();
+    for (Page const& page : pages) {
+      m_page_count += prefix_count(page.table);
+    }
+  }
+}
+
+void ReverseMapping::enumerate(uint64_t const table_base_address, size_t const level, Parent const& parent,
+                               std::vector<uint32_t>& visited) const
+{
+  uint64_t const* table = m_memory.frame(part_of_logical_address(table_base_address, PHYSICAL_ADDRESS_MASK) >>
+                                         PhysicalMemory::FRAME_SHIFT);
+  if (!table) {
+    return;
+  }
+  size_t const depth = m_mode.depth();
+  size_t const key = (table - m_memory.tables()) / PhysicalMemory::ENTRIES_PER_FRAME * depth + level;
+  if (visited[key] != NOT_VISITED) {
+    // Levels only grow on the way down, so the parent can't be the table itself or below it
+    m_tables[visited[key]].parents.push_back(parent);
+    ++m_shared_tables;
+    return;
+  }
+  uint32_t const id = static_cast<uint32_t>(m_tables.size());
+  visited[key] = id;
+  m_tables.emplace_back();
+  if (parent.table != NOT_VISITED) {
+    m_tables[id].parents.push_back(parent);
+  }
+
+  AddressPart const& part = m_mode.levels()[level];
+  AddressPart const& present = m_mode.present_bit_only ? PRESENT_BIT_MASK : LAST_BIT_MASK;
+  size_t const levels_below = depth - 1 - level;
+
+  for (uint64_t idx = 0; idx < PhysicalMemory::ENTRIES_PER_FRAME; ++idx) {
+    uint64_t const entry = table[idx];
+    if (!part_of_logical_address(entry, present)) {
+      continue;
+    }
+    uint64_t const logical = idx << part.shift;
+
+    if (levels_below == 0) {
+      m_pages[0].push_back(Page { part_of_logical_address(entry, PHYSICAL_ADDRESS_MASK), id, logical });
+    } else if (m_mode.large_pages && (levels_below == 1 || levels_below == 2) &&
+               part_of_logical_address(entry, PAGE_SIZE_BIT_MASK)) {
+      uint64_t const offset_mask = (1ULL << part.shift) - 1;
+      m_pages[levels_below].push_back(Page { entry & PHYSICAL_ADDRESS_MASK.mask & ~offset_mask, id, logical });
+    } else {
+      enumerate(entry, level + 1, Parent { id, logical }, visited);
+    }
+  }
+}
+
+uint64_t ReverseMapping::prefix_count(uint32_t const table) const {
+  Table& state = m_tables[table];
+  if (state.prefix_count == 0) {
+    if (state.parents.empty()) {
+      state.prefix_count = 1;  // the root
+    }
+    for (Parent const& parent : state.parents) {
+      state.prefix_count += prefix_count(parent.table);
+    }
+  }
+  return state.prefix_count;
+}
+
+void ReverseMapping::expand(uint32_t const table, uint64_t const logical, std::vector<uint64_t>& out) const {
+  Table const& state = m_tables[table];
+  if (state.parents.empty()) {
+    out.push_back(logical);
+    return;
+  }
+  for (Parent const& parent : state.parents) {
+    expand(parent.table, logical | parent.logical, out);
+  }
+}
+
+template <typename Visit>
+void ReverseMapping::for_each_page(size_t const size, uint64_t const base, Visit const& visit) const {
+  auto const& pages = m_pages[size];
+  for (auto it = std::lower_bound(pages.begin(), pages.end(), Page { base, 0, 0 });
+       it != pages.end() && it->physical == base; ++it) {
+    visit(*it);
+  }
+}
+
+size_t ReverseMapping::logical_addresses(uint64_t const physical, std::vector<uint64_t>& out) const {
+  std::call_once(m_built, [this]() { build(); });
+
+  size_t const before = out.size();
+  for (size_t size = 0; size < PAGE_SIZES; ++size) {
+    uint64_t const base = physical & ~((1ULL << PAGE_SHIFTS[size]) - 1);
+    for_each_page(size, base, [&](Page const& page) {
+      size_t const first = out.size();
+      expand(page.table, page.logical, out);
+      for (size_t i = first; i < out.size(); ++i) {
+        out[i] += physical - base;
+      }
+    });
+  }
+  return out.size() - before;
+}
+
+size_t ReverseMapping::mapping_count(uint64_t const physical) const {
+  std::call_once(m_built, [this]() { build(); });
+
+  size_t count = 0;
+  for (size_t size = 0; size < PAGE_SIZES; ++size) {
+    uint64_t const base = physical & ~((1ULL << PAGE_SHIFTS[size]) - 1);
+    for_each_page(size, base, [&](Page const& page) { count += m_tables[page.table].prefix_count; });
+  }
+  return count;
+}
+
+std::vector<uint64_t> const& ReverseMapping::shared_frames() const {
+  std::call_once(m_shared_built, [this]() {
+    std::call_once(m_built, [this]() { build(); });
+    // A frame inside a large page is shared with it if a 4 KiB page maps it too, so checking the base of every
+    // page finds 4 KiB frames mapped twice, large pages mapped twice and 4 KiB pages inside large ones
+    for (auto const& pages : m_pages) {
+      for (size_t i = 0; i < pages.size(); ++i) {
+        if ((i == 0 || pages[i - 1].physical != pages[i].physical) && mapping_count(pages[i].physical) > 1) {
+          m_shared_frames.push_back(pages[i].physical);
+        }
+      }
+    }
+    std::sort(m_shared_frames.begin(), m_shared_frames.end());
+    m_shared_frames.erase(std::unique(m_shared_frames.begin(), m_shared_frames.end()), m_shared_frames.end());
+  });
+  return m_shared_frames;
+}
+
+size_t ReverseMapping::page_count() const {
+  std::call_once(m_built, [this]() { build(); });
+  return m_page_count;
+}
+
+size_t ReverseMapping::shared_tables() const {
+  std::call_once(m_built, [this]() { build(); });
+  return m_shared_tables;
+}
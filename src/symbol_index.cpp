@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <cstring>
+
+#include "../include/symbol_index.h"
+
+constexpr std::uint32_t SymbolIndex::NONE;
+
+namespace {
+  constexpr std::uint8_t STT_SECTION = 3;
+  constexpr std::uint8_t STT_FILE = 4;
+
+  // Global and weak definitions win over local ones at the same address, then the bigger symbol
+  int rank(Symbol const& symbol) {
+    return symbol.binding == STB_GLOBAL ? 0 : symbol.binding == STB_WEAK ? 1 : 2;
+  }
+}
+
+std::uint32_t SymbolIndex::gnu_hash(char const* name) {
+  std::uint32_t h = 5381;
+  for (auto p = reinterpret_cast<unsigned char const*>(name); *p; ++p) {
+    h = h * 33 + *p;
+  }
+  return h;
+}
+
+bool SymbolIndex::build(ElfImage const& image) {
+  *this = SymbolIndex();
+
+  elf_shdr const* const symtab = image.find_section(SHT_SYMTAB);
+  elf_shdr const* const dynsym = image.find_section(SHT_DYNSYM);
+  if (!symtab && !dynsym) {
+    m_error = "no symbol table";
+    return false;
+  }
+  if (symtab && !load_table(image, *symtab, false)) {
+    return false;
+  }
+  size_t const static_symbols = m_symbols.size();
+  if (dynsym && !load_table(image, *dynsym, true)) {
+    return false;
+  }
+
+  // .gnu.hash that indexes this .dynsym
+  if (dynsym) {
+    size_t const dynsym_idx = dynsym - &image.section(0);
+    for (size_t i = 0; i < image.section_count(); ++i) {
+      if (image.section(i).sh_type == SHT_GNU_HASH && image.section(i).sh_link == dynsym_idx) {
+        load_gnu_hash(image, image.section(i));
+        break;
+      }
+    }
+  }
+
+  size_t const hashed = m_gnu_buckets ? static_symbols : m_symbols.size();
+  size_t capacity = 2;
+  while (capacity < hashed * 2) {
+    capacity *= 2;
+  }
+  m_slots.assign(capacity, NONE);
+  m_slot_hashes.assign(capacity, 0);
+  for (size_t i = 0; i < hashed; ++i) {
+    insert(static_cast<std::uint32_t>(i), gnu_hash(m_symbols[i].name));
+  }
+
+  // Address ranges: functions and objects, one per start address
+  std::vector<std::uint32_t> order;
+  for (size_t i = 0; i < m_symbols.size(); ++i) {
+    Symbol const& symbol = m_symbols[i];
+    if ((symbol.type == STT_FUNC || symbol.type == STT_OBJECT) && symbol.address) {
+      order.push_back(static_cast<std::uint32_t>(i));
+    }
+  }
+  std::sort(order.begin(), order.end(), [this](std::uint32_t a, std::uint32_t b) {
+    Symbol const& x = m_symbols[a];
+    Symbol const& y = m_symbols[b];
+    if (x.address != y.address) {
+      return x.address < y.address;
+    }
+    if (rank(x) != rank(y)) {
+      return rank(x) < rank(y);
+    }
+    return x.size > y.size;
+  });
+  for (std::uint32_t idx : order) {
+    if (m_starts.empty() || m_starts.back() != m_symbols[idx].address) {
+      m_starts.push_back(m_symbols[idx].address);
+      m_ranges.push_back(Range { m_symbols[idx].address + m_symbols[idx].size, idx });
+    }
+  }
+  for (size_t i = 0; i < m_ranges.size(); ++i) {
+    if (m_ranges[i].end == m_starts[i]) {
+      m_ranges[i].end = i + 1 < m_starts.size() ? m_starts[i + 1] : m_starts[i] + 1;
+    }
+  }
+  flatten_ranges();
+  return true;
+}
+
+// A lookup only looks at the range with the greatest start, so the addresses of an enclosing symbol after the end of
+// a nested one get ranges of their own, back to the innermost symbol that still covers them
+void SymbolIndex::flatten_ranges() {
+  std::vector<std::uint64_t> starts;
+  std::vector<Range> ranges;
+  std::vector<Range> enclosing;  // ranges that may still cover later addresses, the innermost last
+  std::uint64_t covered = 0;     // end of the last range added
+  auto const fill = [&](std::uint64_t const limit) {
+    while (!enclosing.empty() && covered < limit) {
+      Range const outer = enclosing.back();
+      if (outer.end <= covered) {
+        enclosing.pop_back();
+        continue;
+      }
+      std::uint64_t const end = std::min(outer.end, limit);
+      starts.push_back(covered);
+      ranges.push_back(Range { end, outer.symbol });
+      covered = end;
+    }
+  };
+  for (size_t i = 0; i < m_ranges.size(); ++i) {
+    fill(m_starts[i]);
+    starts.push_back(m_starts[i]);
+    ranges.push_back(m_ranges[i]);
+    enclosing.push_back(m_ranges[i]);
+    covered = m_ranges[i].end;
+  }
+  fill(~std::uint64_t(0));
+  m_starts = std::move(starts);
+  m_ranges = std::move(ranges);
+}
+
+bool SymbolIndex::load_table(ElfImage const& image, elf_shdr const& table, bool const dynamic) {
+  std::uint64_t const entry_size = table.sh_entsize ? table.sh_entsize : sizeof(elf_sym);
+  char const* const data = image.section_data(table);
+  if (entry_size < sizeof(elf_sym) || !data || table.sh_link >= image.section_count()) {
+    m_error = "corrupted symbol table";
+    return false;
+  }
+  elf_shdr const& strtab = image.section(table.sh_link);
+  char const* const strings = image.section_data(strtab);
+  // A terminated last string makes every offset inside the table a valid C string
+  if (!strings || strtab.sh_size == 0 || strings[strtab.sh_size - 1] != 0) {
+    m_error = "corrupted symbol string table";
+    return false;
+  }
+
+  size_t const count = table.sh_size / entry_size;
+  if (dynamic) {
+    m_dynsym_symbol.assign(count, NONE);
+  }
+  for (size_t i = 1; i < count; ++i) {
+    elf_sym const& sym = *reinterpret_cast<elf_sym const*>(data + i * entry_size);
+    std::uint8_t const type = sym.st_info & 0xf;
+    if (sym.st_shndx == SHN_UNDEF || type == STT_SECTION || type == STT_FILE || sym.st_name >= strtab.sh_size ||
+        !strings[sym.st_name]) {
+      continue;
+    }
+    if (dynamic) {
+      m_dynsym_symbol[i] = static_cast<std::uint32_t>(m_symbols.size());
+    }
+    m_symbols.push_back(Symbol { sym.st_value, sym.st_size, strings + sym.st_name, type,
+                                 static_cast<std::uint8_t>(sym.st_info >> 4) });
+  }
+  return true;
+}
+
+void SymbolIndex::load_gnu_hash(ElfImage const& image, elf_shdr const& table) {
+  char const* const data = image.section_data(table);
+  if (!data || table.sh_size < 16 || reinterpret_cast<std::uintptr_t>(data) % 8) {
+    return;
+  }
+  auto const words = reinterpret_cast<std::uint32_t const*>(data);
+  std::uint32_t const bucket_count = words[0], symoffset = words[1], bloom_size = words[2];
+  std::uint64_t const tables_size = 16 + std::uint64_t(bloom_size) * 8 + std::uint64_t(bucket_count) * 4;
+  if (!bucket_count || !bloom_size || tables_size > table.sh_size || symoffset > m_dynsym_symbol.size()) {
+    return;
+  }
+
+  m_gnu_bucket_count = bucket_count;
+  m_gnu_symoffset = symoffset;
+  m_gnu_bloom_size = bloom_size;
+  m_gnu_bloom_shift = words[3];
+  m_gnu_bloom = reinterpret_cast<std::uint64_t const*>(data + 16);
+  m_gnu_buckets = reinterpret_cast<std::uint32_t const*>(data + 16 + std::uint64_t(bloom_size) * 8);
+  m_gnu_chain = m_gnu_buckets + bucket_count;
+  m_gnu_chain_size = (table.sh_size - tables_size) / 4;
+}
+
+void SymbolIndex::insert(std::uint32_t const symbol, std::uint32_t const hash) {
+  size_t const mask = m_slots.size() - 1;
+  size_t slot = hash & mask;
+  while (m_slots[slot] != NONE) {
+    slot = (slot + 1) & mask;
+  }
+  m_slots[slot] = symbol;
+  m_slot_hashes[slot] = hash;
+}
+
+Symbol const* SymbolIndex::find(char const* name) const {
+  std::uint32_t const hash = gnu_hash(name);
+  size_t const mask = m_slots.size() - 1;
+  for (size_t slot = hash & mask; m_slots[slot] != NONE; slot = (slot + 1) & mask) {
+    if (m_slot_hashes[slot] == hash && std::strcmp(m_symbols[m_slots[slot]].name, name) == 0) {
+      return &m_symbols[m_slots[slot]];
+    }
+  }
+  return m_gnu_buckets ? find_gnu_hash(name, hash) : nullptr;
+}
+
+Symbol const* SymbolIndex::find_gnu_hash(char const* name, std::uint32_t const hash) const {
+  std::uint64_t const word = m_gnu_bloom[(hash / 64) % m_gnu_bloom_size];
+  std::uint64_t const bits = (1ULL << (hash % 64)) | (1ULL << ((hash >> m_gnu_bloom_shift) % 64));
+  if ((word & bits) != bits) {
+    return nullptr;
+  }
+
+  // The chain holds the hashes of the symbols of one bucket, the lowest bit marks the last one
+  for (std::uint32_t idx = m_gnu_buckets[hash % m_gnu_bucket_count];
+       idx >= m_gnu_symoffset && idx - m_gnu_symoffset < m_gnu_chain_size && idx < m_dynsym_symbol.size(); ++idx) {
+    std::uint32_t const chain_hash = m_gnu_chain[idx - m_gnu_symoffset];
+    std::uint32_t const symbol = m_dynsym_symbol[idx];
+    if ((chain_hash | 1) == (hash | 1) && symbol != NONE && std::strcmp(m_symbols[symbol].name, name) == 0) {
+      return &m_symbols[symbol];
+    }
+    if (chain_hash & 1) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+Symbol const* SymbolIndex::symbolize(std::uint64_t const address, std::uint64_t* offset) const {
+  auto const it = std::upper_bound(m_starts.begin(), m_starts.end(), address);
+  if (it == m_starts.begin()) {
+    return nullptr;
+  }
+  size_t const idx = it - m_starts.begin() - 1;
+  if (address >= m_ranges[idx].end) {
+    return nullptr;
+  }
+  Symbol const& symbol = m_symbols[m_ranges[idx].symbol];
+  if (offset) {
+    *offset = address - symbol.address;
+  }
+  return &symbol;
+}
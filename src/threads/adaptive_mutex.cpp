@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "../../include/threads/adaptive_mutex.h"
+
+constexpr uint32_t AdaptiveMutex::UNLOCKED;
+constexpr uint32_t AdaptiveMutex::LOCKED;
+constexpr uint32_t AdaptiveMutex::CONTENDED;
+constexpr uint32_t AdaptiveMutex::MIN_SPIN;
+constexpr uint32_t AdaptiveMutex::MAX_SPIN;
+constexpr uint32_t AdaptiveMutex::MAX_BACKOFF;
+
+namespace {
+  void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+  }
+
+#ifdef __linux__
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(int), "the futex word is a 32-bit int");
+
+  int* futex_address(std::atomic<uint32_t>& word) {
+    return reinterpret_cast<int*>(&word);
+  }
+#endif
+}
+
+void AdaptiveMutex::lock_slow() {
+  if (spin()) {
+    return;
+  }
+  // From here on the word stays CONTENDED while anyone may sleep: whoever takes the lock by the exchange
+  // doesn't know if others are asleep, so it has to wake one on unlock
+  while (m_word.exchange(CONTENDED, std::memory_order_acquire) != UNLOCKED) {
+    wait();
+  }
+}
+
+bool AdaptiveMutex::spin() {
+  uint32_t const budget = m_spin_budget.load(std::memory_order_relaxed);
+  uint32_t backoff = 1;
+  for (uint32_t reads = 0; reads < budget; ++reads) {
+    uint32_t state = m_word.load(std::memory_order_relaxed);
+    if (state == CONTENDED) {
+      break;  // others already sleep, spinning would only jump the queue
+    }
+    if (state == UNLOCKED &&
+        m_word.compare_exchange_weak(state, LOCKED, std::memory_order_acquire, std::memory_order_relaxed)) {
+      set_spin_budget(budget, std::min(MAX_SPIN, budget + budget / 8 + 1));
+      return true;
+    }
+    for (uint32_t i = 0; i < backoff; ++i) {
+      cpu_relax();
+    }
+    backoff = std::min(MAX_BACKOFF, backoff * 2);
+  }
+  set_spin_budget(budget, std::max(MIN_SPIN, budget - budget / 8));
+  return false;
+}
+
+void AdaptiveMutex::set_spin_budget(uint32_t const old_budget, uint32_t const new_budget) {
+  if (new_budget != old_budget) {
+    m_spin_budget.store(new_budget, std::memory_order_relaxed);
+  }
+}
+
+void AdaptiveMutex::wait() {
+  m_sleeps.fetch_add(1, std::memory_order_relaxed);
+#ifdef __linux__
+  // Returns right away if the word is no longer CONTENDED, a wakeup can't be lost
+  syscall(SYS_futex, futex_address(m_word), FUTEX_WAIT_PRIVATE, static_cast<int>(CONTENDED), nullptr, nullptr, 0);
+#else
+  std::this_thread::yield();
+#endif
+}
+
+void AdaptiveMutex::wake_one() {
+  m_wakes.fetch_add(1, std::memory_order_relaxed);
+#ifdef __linux__
+  syscall(SYS_futex, futex_address(m_word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+}
@@ -0,0 +1,96 @@
+#include <chrono>
+#include <thread>
+
+#include "../../include/threads/distributed_rw_lock.h"
+
+constexpr int DistributedRWLock::SLOTS;
+constexpr uint64_t DistributedRWLock::INHIBIT_FACTOR;
+constexpr int DistributedRWLock::SHARED;
+
+namespace {
+  std::atomic<uint32_t> next_thread_slot { 0 };
+
+  uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+}
+
+int DistributedRWLock::thread_slot() {
+  thread_local int const slot = static_cast<int>(next_thread_slot.fetch_add(1, std::memory_order_relaxed) % SLOTS);
+  return slot;
+}
+
+// The fast path and revoke_bias() are Dekker-style: a reader marks its slot and then reads the bias, a writer
+// clears the bias and then reads the slots, so both sides need seq_cst to see at least one another
+int DistributedRWLock::read_lock() {
+  if (m_bias.value.load(std::memory_order_relaxed)) {
+    int const slot = thread_slot();
+    uint32_t expected = 0;
+    if (m_slots[slot].value.compare_exchange_strong(expected, 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed)) {
+      if (m_bias.value.load(std::memory_order_seq_cst)) {
+        return slot;
+      }
+      m_slots[slot].value.store(0, std::memory_order_release);  // a writer revoked the bias meanwhile
+    }
+  }
+  read_lock_slow();
+  return SHARED;
+}
+
+void DistributedRWLock::read_unlock(int const token) {
+  if (token == SHARED) {
+    m_readers.value.fetch_sub(1, std::memory_order_release);
+  } else {
+    m_slots[token].value.store(0, std::memory_order_release);
+  }
+}
+
+// Same pattern between the reader and writer counters
+void DistributedRWLock::read_lock_slow() {
+  m_slow_reads.fetch_add(1, std::memory_order_relaxed);
+  for (;;) {
+    while (m_writers.value.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+    m_readers.value.fetch_add(1, std::memory_order_seq_cst);
+    if (m_writers.value.load(std::memory_order_seq_cst) == 0) {
+      break;
+    }
+    m_readers.value.fetch_sub(1, std::memory_order_release);
+  }
+  // No writer can get in while this reader holds the lock, so it may turn the bias back on
+  if (!m_bias.value.load(std::memory_order_relaxed) && now_ns() >= m_inhibit_until.load(std::memory_order_relaxed)) {
+    m_bias.value.store(true, std::memory_order_release);
+  }
+}
+
+void DistributedRWLock::write_lock() {
+  m_writers.value.fetch_add(1, std::memory_order_seq_cst);
+  m_write_mutex.lock();
+  while (m_readers.value.load(std::memory_order_seq_cst) != 0) {
+    std::this_thread::yield();
+  }
+  if (m_bias.value.load(std::memory_order_relaxed)) {
+    revoke_bias();
+  }
+}
+
+void DistributedRWLock::write_unlock() {
+  m_write_mutex.unlock();
+  m_writers.value.fetch_sub(1, std::memory_order_release);
+}
+
+void DistributedRWLock::revoke_bias() {
+  m_revocations.fetch_add(1, std::memory_order_relaxed);
+  uint64_t const start = now_ns();
+  m_bias.value.store(false, std::memory_order_seq_cst);
+  for (Slot const& slot : m_slots) {
+    while (slot.value.load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+  }
+  uint64_t const end = now_ns();
+  m_inhibit_until.store(end + (end - start) * INHIBIT_FACTOR, std::memory_order_relaxed);
+}
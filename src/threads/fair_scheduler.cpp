@@ -0,0 +1,134 @@
+#include <algorithm>
+
+#include "../../include/threads/fair_scheduler.h"
+
+constexpr int FairScheduler::NICE_MIN;
+constexpr int FairScheduler::NICE_MAX;
+constexpr uint64_t FairScheduler::NICE_0_TICK;
+
+namespace {
+  // sched_prio_to_weight of Linux for nice -20..19: one nice level apart is about 10% of the CPU
+  constexpr uint32_t NICE_TO_WEIGHT[40] = {
+      88761, 71755, 56483, 46273, 36291,
+      29154, 23254, 18705, 14949, 11916,
+      9548,  7620,  6100,  4904,  3906,
+      3121,  2501,  1991,  1586,  1277,
+      1024,  820,   655,   526,   423,
+      335,   272,   215,   172,   137,
+      110,   87,    70,    56,    45,
+      36,    29,    23,    18,    15,
+  };
+
+  constexpr uint32_t NICE_0_WEIGHT = 1024;
+}
+
+FairScheduler::FairScheduler(FairConfig const& config, size_t const capacity) {
+  m_threads.reserve(capacity);
+  setup(config);
+}
+
+void FairScheduler::setup(FairConfig const& config) {
+  m_latency = std::max<uint64_t>(config.latency, 1);
+  m_min_granularity = std::max<uint64_t>(config.min_granularity, 1);
+  m_wakeup_granularity = config.wakeup_granularity * NICE_0_TICK;
+  m_current = -1;
+  m_ran = 0;
+  m_slice = 0;
+  m_min_vruntime = 0;
+  m_total_weight = 0;
+  m_tree.clear();
+  m_threads.clear();
+}
+
+uint32_t FairScheduler::nice_to_weight(int const nice) {
+  return NICE_TO_WEIGHT[std::min(std::max(nice, NICE_MIN), NICE_MAX) - NICE_MIN];
+}
+
+void FairScheduler::new_thread(int const thread_id, int const nice) {
+  if (static_cast<size_t>(thread_id) >= m_threads.size()) {
+    m_threads.resize(thread_id + 1);
+  }
+  Thread& thread = m_threads[thread_id];
+  thread.weight = nice_to_weight(nice);
+  thread.delta = NICE_0_TICK * NICE_0_WEIGHT / thread.weight;
+  thread.vruntime = m_min_vruntime;
+  make_runnable(thread_id);
+}
+
+void FairScheduler::exit_thread() {
+  if (m_current != -1) {
+    m_total_weight -= m_threads[m_current].weight;
+    pick_next();
+  }
+}
+
+void FairScheduler::block_thread() {
+  exit_thread();  // the same for the scheduler, the vruntime is kept for the wakeup
+}
+
+void FairScheduler::wake_thread(int const thread_id) {
+  Thread& thread = m_threads[thread_id];
+  thread.vruntime = std::max(thread.vruntime, m_min_vruntime);
+  make_runnable(thread_id);
+}
+
+void FairScheduler::timer_tick() {
+  if (m_current == -1) {
+    return;
+  }
+  Thread& current = m_threads[m_current];
+  current.vruntime += current.delta;
+  ++m_ran;
+  update_min_vruntime();
+  if (m_ran >= m_slice && !m_tree.empty()) {
+    m_tree.emplace(current.vruntime, m_current);
+    pick_next();
+  }
+}
+
+void FairScheduler::make_runnable(int const thread_id) {
+  Thread const& thread = m_threads[thread_id];
+  m_total_weight += thread.weight;
+  if (m_current == -1) {
+    m_current = thread_id;
+    start_slice();
+    update_min_vruntime();
+    return;
+  }
+  Thread const& current = m_threads[m_current];
+  if (thread.vruntime + m_wakeup_granularity < current.vruntime) {
+    m_tree.emplace(current.vruntime, m_current);
+    m_current = thread_id;
+    start_slice();
+  } else {
+    m_tree.emplace(thread.vruntime, thread_id);
+  }
+}
+
+void FairScheduler::pick_next() {
+  if (m_tree.empty()) {
+    m_current = -1;
+    return;
+  }
+  auto const leftmost = m_tree.begin();
+  m_current = leftmost->second;
+  m_tree.erase(leftmost);
+  start_slice();
+  update_min_vruntime();
+}
+
+void FairScheduler::start_slice() {
+  m_ran = 0;
+  m_slice = std::max(m_min_granularity, m_latency * m_threads[m_current].weight / m_total_weight);
+}
+
+// min_vruntime only moves forward, it follows the least vruntime among the runnable threads
+void FairScheduler::update_min_vruntime() {
+  uint64_t least = m_current != -1 ? m_threads[m_current].vruntime : UINT64_MAX;
+  if (!m_tree.empty()) {
+    least = std::min(least, m_tree.begin()->first);
+  }
+  if (least != UINT64_MAX) {
+    m_min_vruntime = std::max(m_min_vruntime, least);
+  }
+}
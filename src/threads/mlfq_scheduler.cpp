@@ -0,0 +1,54 @@
+#include <algorithm>
+
+#include "../../include/threads/mlfq_scheduler.h"
+
+constexpr int MlfqScheduler::MAX_LEVELS;
+
+MlfqScheduler::MlfqScheduler(MlfqConfig const& config, size_t const capacity) : m_queues(MAX_LEVELS) {
+  m_threads.reserve(capacity);
+  setup(config);
+}
+
+void MlfqScheduler::setup(MlfqConfig const& config) {
+  m_current = -1;
+  m_levels = static_cast<uint32_t>(std::min(std::max(config.levels, 1), MAX_LEVELS));
+  m_boost_period = config.boost_period;
+  m_since_boost = 0;
+  m_epoch = 0;
+  m_demotions = 0;
+  m_nonempty = 0;
+  m_queued = 0;
+  m_quantum.assign(m_levels, 0);
+  uint64_t quantum = static_cast<uint64_t>(std::max(config.base_quantum, 1));
+  for (uint32_t level = 0; level < m_levels; ++level) {
+    m_quantum[level] = static_cast<uint32_t>(quantum);
+    quantum = std::min<uint64_t>(quantum * 2, UINT32_MAX);
+  }
+  std::fill(m_queues.begin(), m_queues.end(), Queue());
+  m_threads.clear();
+}
+
+// The lower levels are spliced after the top one keeping their order, a thread's own record is reset lazily
+// by the new epoch when it is picked or woken, so a boost costs O(levels) whatever the number of threads
+void MlfqScheduler::boost() {
+  m_since_boost = 0;
+  ++m_epoch;
+  Queue& top = m_queues[0];
+  for (uint32_t level = 1; level < m_levels; ++level) {
+    Queue& queue = m_queues[level];
+    if (queue.head == -1) {
+      continue;
+    }
+    if (top.tail == -1) {
+      top.head = queue.head;
+    } else {
+      m_threads[top.tail].next = queue.head;
+    }
+    top.tail = queue.tail;
+    queue = Queue();
+  }
+  m_nonempty = top.head == -1 ? 0 : 1;
+  if (m_current != -1) {
+    refresh(m_threads[m_current]);
+  }
+}
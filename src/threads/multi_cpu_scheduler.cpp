@@ -0,0 +1,172 @@
+#include <algorithm>
+
+#include "../../include/threads/multi_cpu_scheduler.h"
+
+char const* wake_placement_name(WakePlacement const placement) {
+  switch (placement) {
+  case WakePlacement::PREVIOUS:
+    return "previous";
+  case WakePlacement::AFFINE:
+    return "wake-affine";
+  case WakePlacement::IDLEST:
+    return "idlest";
+  }
+  return "?";
+}
+
+MultiCpuScheduler::MultiCpuScheduler(MultiCpuConfig const& config, size_t const capacity) : m_capacity(capacity) {
+  m_last_cpu.reserve(capacity);
+  setup(config);
+}
+
+void MultiCpuScheduler::setup(MultiCpuConfig const& config) {
+  m_config = config;
+  m_config.cpus = std::max(config.cpus, 1);
+  m_timeslice = static_cast<uint64_t>(std::max(config.timeslice, 1));
+  if (m_cpus.size() != static_cast<size_t>(m_config.cpus)) {
+    m_cpus.clear();
+    for (int i = 0; i < m_config.cpus; ++i) {
+      m_cpus.push_back(Cpu { -1, 0, RunQueue(m_capacity), CpuStats() });
+    }
+  }
+  for (auto& cpu : m_cpus) {
+    cpu.current = -1;
+    cpu.time = 0;
+    cpu.queue.clear();
+    cpu.stats = CpuStats();
+  }
+  m_last_cpu.clear();
+  m_migrations = 0;
+  m_samples = 0;
+  m_imbalance_sum = 0;
+  m_imbalance_max = 0;
+}
+
+void MultiCpuScheduler::new_thread(int const thread_id) {
+  if (static_cast<size_t>(thread_id) >= m_last_cpu.size()) {
+    m_last_cpu.resize(thread_id + 1, -1);
+  }
+  m_last_cpu[thread_id] = -1;
+  enqueue(idlest_cpu(), thread_id);
+}
+
+void MultiCpuScheduler::exit_thread(int const cpu) {
+  switch_to_next(cpu);
+}
+
+void MultiCpuScheduler::block_thread(int const cpu) {
+  switch_to_next(cpu);
+}
+
+void MultiCpuScheduler::wake_thread(int const thread_id, int const waker_cpu) {
+  enqueue(select_wake_cpu(thread_id, waker_cpu), thread_id);
+}
+
+void MultiCpuScheduler::timer_tick(int const cpu) {
+  Cpu& state = m_cpus[cpu];
+  if (state.current == -1) {
+    ++state.stats.idle_ticks;
+    if (m_config.steal) {
+      steal(cpu);  // another CPU may have queued work since this one went idle
+    }
+    return;
+  }
+  ++state.stats.busy_ticks;
+  if (++state.time == m_timeslice) {
+    state.time = 0;
+    if (!state.queue.empty()) {
+      state.queue.push_back(state.current);
+      dispatch(cpu, state.queue.pop_front());
+    }
+  }
+}
+
+void MultiCpuScheduler::timer_tick() {
+  size_t least = SIZE_MAX, most = 0;
+  for (int cpu = 0; cpu < cpus(); ++cpu) {
+    timer_tick(cpu);
+    least = std::min(least, load(cpu));
+    most = std::max(most, load(cpu));
+  }
+  ++m_samples;
+  m_imbalance_sum += most - least;
+  m_imbalance_max = std::max(m_imbalance_max, most - least);
+}
+
+void MultiCpuScheduler::enqueue(int const cpu, int const thread_id) {
+  if (m_cpus[cpu].current == -1) {
+    dispatch(cpu, thread_id);
+  } else {
+    m_cpus[cpu].queue.push_back(thread_id);
+  }
+}
+
+void MultiCpuScheduler::dispatch(int const cpu, int const thread_id) {
+  Cpu& state = m_cpus[cpu];
+  state.current = thread_id;
+  state.time = 0;
+  int& last = m_last_cpu[thread_id];
+  if (last != -1 && last != cpu) {
+    ++m_migrations;
+  }
+  last = cpu;
+}
+
+void MultiCpuScheduler::switch_to_next(int const cpu) {
+  Cpu& state = m_cpus[cpu];
+  if (!state.queue.empty()) {
+    dispatch(cpu, state.queue.pop_front());
+    return;
+  }
+  state.current = -1;
+  if (m_config.steal) {
+    steal(cpu);
+  }
+}
+
+// Takes the thread queued last on the CPU with the longest queue: it would wait there the longest
+bool MultiCpuScheduler::steal(int const cpu) {
+  int busiest = -1;
+  size_t longest = 0;
+  for (int other = 0; other < cpus(); ++other) {
+    if (m_cpus[other].queue.size() > longest) {
+      longest = m_cpus[other].queue.size();
+      busiest = other;
+    }
+  }
+  if (busiest == -1) {
+    return false;
+  }
+  ++m_cpus[cpu].stats.steals;
+  dispatch(cpu, m_cpus[busiest].queue.pop_back());
+  return true;
+}
+
+int MultiCpuScheduler::select_wake_cpu(int const thread_id, int const waker_cpu) const {
+  int const previous = m_last_cpu[thread_id];
+  if (previous == -1 || m_config.placement == WakePlacement::IDLEST) {
+    return idlest_cpu();
+  }
+  if (m_config.placement == WakePlacement::PREVIOUS || load(previous) == 0) {
+    return previous;
+  }
+  if (waker_cpu != -1 && load(waker_cpu) == 0) {
+    return waker_cpu;
+  }
+  for (int cpu = 0; cpu < cpus(); ++cpu) {
+    if (load(cpu) == 0) {
+      return cpu;
+    }
+  }
+  return waker_cpu != -1 && load(waker_cpu) < load(previous) ? waker_cpu : previous;
+}
+
+int MultiCpuScheduler::idlest_cpu() const {
+  int res = 0;
+  for (int cpu = 1; cpu < cpus(); ++cpu) {
+    if (load(cpu) < load(res)) {
+      res = cpu;
+    }
+  }
+  return res;
+}
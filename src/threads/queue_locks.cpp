@@ -0,0 +1,105 @@
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#ifdef _WINDOWS
+#include <malloc.h>
+#endif
+
+#include "../../include/threads/queue_locks.h"
+
+namespace {
+  // Spare CLH nodes of the thread, freed when it exits. A node taken by one thread may be returned by another,
+  // so the counts differ per thread, but every node is in exactly one list or one lock queue.
+  class ClhNodePool {
+  public:
+    ~ClhNodePool() {
+      for (ClhLock::Node* node : m_free) {
+        delete node;
+      }
+    }
+
+    ClhLock::Node* take() {
+      if (m_free.empty()) {
+        return new ClhLock::Node();
+      }
+      ClhLock::Node* node = m_free.back();
+      m_free.pop_back();
+      return node;
+    }
+
+    void give(ClhLock::Node* node) { m_free.push_back(node); }
+
+  private:
+    std::vector<ClhLock::Node*> m_free;
+  };
+
+  thread_local ClhNodePool clh_pool;
+}
+
+void McsLock::lock(Node& node) {
+  node.next.store(nullptr, std::memory_order_relaxed);
+  node.locked.store(true, std::memory_order_relaxed);
+  Node* predecessor = m_tail.exchange(&node, std::memory_order_acq_rel);
+  if (predecessor == nullptr) {
+    return;
+  }
+  predecessor->next.store(&node, std::memory_order_release);
+  while (node.locked.load(std::memory_order_acquire));
+}
+
+void McsLock::unlock(Node& node) {
+  Node* successor = node.next.load(std::memory_order_acquire);
+  if (successor == nullptr) {
+    Node* expected = &node;
+    if (m_tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+      return;
+    }
+    // A waiter swapped the tail but hasn't linked itself yet
+    while ((successor = node.next.load(std::memory_order_acquire)) == nullptr);
+  }
+  successor->locked.store(false, std::memory_order_release);
+}
+
+void* ClhLock::Node::operator new(size_t const size) {
+#ifdef _WINDOWS
+  void* memory = _aligned_malloc(size, alignof(Node));
+#else
+  void* memory = nullptr;
+  if (posix_memalign(&memory, alignof(Node), size) != 0) {
+    memory = nullptr;
+  }
+#endif
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void ClhLock::Node::operator delete(void* const node) {
+#ifdef _WINDOWS
+  _aligned_free(node);
+#else
+  free(node);
+#endif
+}
+
+ClhLock::ClhLock() : m_tail(new Node()) {}
+
+ClhLock::~ClhLock() {
+  delete m_tail.load();
+}
+
+ClhLock::Node* ClhLock::lock() {
+  Node* node = clh_pool.take();
+  node->locked.store(true, std::memory_order_relaxed);
+  node->predecessor = m_tail.exchange(node, std::memory_order_acq_rel);
+  while (node->predecessor->locked.load(std::memory_order_acquire));
+  return node;
+}
+
+void ClhLock::unlock(Node* node) {
+  Node* predecessor = node->predecessor;
+  node->locked.store(false, std::memory_order_release);  // from here on 'node' belongs to the successor or the lock
+  clh_pool.give(predecessor);
+}
@@ -1,34 +1,46 @@
-#include <atomic>
-
-namespace {
-  struct RWLock {
-    // Queue for threads
-    std::atomic_uint64_t ticket;
-    // Readers and writers
-    std::atomic_uint64_t read;
-    std::atomic_uint64_t write;
-  };
-
-  void read_lock(RWLock* lock) {
-    uint64_t const ticket = lock->ticket.fetch_add(1);
-
-    while (lock->read.load() != ticket);
-    lock->read.store(ticket + 1);
-  }
-
-  void read_unlock(RWLock* lock) {
-    lock->write.fetch_add(1);
-  }
-
-  void write_lock(RWLock* lock) {
-    uint64_t const ticket = lock->ticket.fetch_add(1);
-
-    while (lock->write.load() != ticket);
-  }
-
-  void write_unlock(RWLock* lock) {
-    lock->read.fetch_add(1);
-    lock->write.fetch_add(1);
-
-  }
-}
\ No newline at end of file
+#include "../../include/threads/read_write_lock.h"
+
+template <typename Layout, typename Order>
+void read_lock(BasicRWLock<Layout, Order>* lock) {
+  uint64_t const ticket = lock->ticket.value.fetch_add(1, Order::RELAXED);
+
+  while (lock->read.value.load(Order::ACQUIRE) != ticket);
+  // Lets the next reader in, which has to see what the last writer wrote as well
+  lock->read.value.store(ticket + 1, Order::RELEASE);
+}
+
+template <typename Layout, typename Order>
+void read_unlock(BasicRWLock<Layout, Order>* lock) {
+  lock->write.value.fetch_add(1, Order::RELEASE);
+}
+
+template <typename Layout, typename Order>
+void write_lock(BasicRWLock<Layout, Order>* lock) {
+  uint64_t const ticket = lock->ticket.value.fetch_add(1, Order::RELAXED);
+
+  while (lock->write.value.load(Order::ACQUIRE) != ticket);
+}
+
+template <typename Layout, typename Order>
+void write_unlock(BasicRWLock<Layout, Order>* lock) {
+  lock->read.value.fetch_add(1, Order::RELEASE);
+  lock->write.value.fetch_add(1, Order::RELEASE);
+
+}
+
+template void read_lock(BasicRWLock<PackedLayout, SeqCstOrder>*);
+template void read_lock(BasicRWLock<PackedLayout, AcquireReleaseOrder>*);
+template void read_lock(BasicRWLock<PaddedLayout, SeqCstOrder>*);
+template void read_lock(BasicRWLock<PaddedLayout, AcquireReleaseOrder>*);
+template void read_unlock(BasicRWLock<PackedLayout, SeqCstOrder>*);
+template void read_unlock(BasicRWLock<PackedLayout, AcquireReleaseOrder>*);
+template void read_unlock(BasicRWLock<PaddedLayout, SeqCstOrder>*);
+template void read_unlock(BasicRWLock<PaddedLayout, AcquireReleaseOrder>*);
+template void write_lock(BasicRWLock<PackedLayout, SeqCstOrder>*);
+template void write_lock(BasicRWLock<PackedLayout, AcquireReleaseOrder>*);
+template void write_lock(BasicRWLock<PaddedLayout, SeqCstOrder>*);
+template void write_lock(BasicRWLock<PaddedLayout, AcquireReleaseOrder>*);
+template void write_unlock(BasicRWLock<PackedLayout, SeqCstOrder>*);
+template void write_unlock(BasicRWLock<PackedLayout, AcquireReleaseOrder>*);
+template void write_unlock(BasicRWLock<PaddedLayout, SeqCstOrder>*);
+template void write_unlock(BasicRWLock<PaddedLayout, AcquireReleaseOrder>*);
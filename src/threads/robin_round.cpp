@@ -1,11 +1,21 @@
 #include <iostream>
-#include <queue>
 #include <cstdint>
 
-int current_thread_id = -1;
-uint64_t m_timeslice = 0;
-uint64_t m_time = 0;
-std::queue<int> thread_pool;
+#include "../../include/threads/round_robin_scheduler.h"
+
+RoundRobinScheduler::RoundRobinScheduler(int const timeslice, size_t const capacity) : m_queue(capacity) {
+  setup(timeslice);
+}
+
+void RoundRobinScheduler::setup(int const timeslice) {
+  m_current = -1;
+  m_timeslice = static_cast<uint64_t>(timeslice);
+  m_time = 0;
+  m_queue.clear();
+}
+
+// The scheduler behind the global API below
+static RoundRobinScheduler scheduler;
 
 /**
  * Функция будет вызвана перед каждым тестом, если вы
@@ -19,10 +29,7 @@ std::queue<int> thread_pool;
  * timer_tick была вызвана timeslice раз.
  **/
 void scheduler_setup(int timeslice) {
-  current_thread_id = -1;
-  ::m_timeslice = timeslice;
-  m_time = 0;
-  thread_pool = {};
+  scheduler.setup(timeslice);
 }
 
 /**
@@ -31,12 +38,7 @@ void scheduler_setup(int timeslice) {
  * никакие два потока не могут иметь одинаковый идентификатор.
  **/
 void new_thread(int thread_id) {
-  if (current_thread_id == -1) {
-    current_thread_id = thread_id;
-    m_time = 0;
-  } else {
-    thread_pool.push(thread_id);
-  }
+  scheduler.new_thread(thread_id);
 }
 
 /**
@@ -47,13 +49,7 @@ void new_thread(int thread_id) {
  * (незаблокированный и незавершившийся) поток.
  **/
 void exit_thread() {
-  if (thread_pool.empty()) {
-    current_thread_id = -1;
-  } else {
-    current_thread_id = thread_pool.front();
-    thread_pool.pop();
-    m_time = 0;
-  }
+  scheduler.exit_thread();
 }
 
 /**
@@ -64,13 +60,7 @@ void exit_thread() {
  * имеется.
  **/
 void block_thread() {
-  if (thread_pool.empty()) {
-    current_thread_id = -1;
-  } else {
-    current_thread_id = thread_pool.front();
-    thread_pool.pop();
-    m_time = 0;
-  }
+  scheduler.block_thread();
 }
 
 /**
@@ -79,12 +69,7 @@ void block_thread() {
  * ранее заблокированного потока.
  **/
 void wake_thread(int thread_id) {
-  if (current_thread_id == -1) {
-    current_thread_id = thread_id;
-    m_time = 0;
-  } else {
-    thread_pool.push(thread_id);
-  }
+  scheduler.wake_thread(thread_id);
 }
 
 /**
@@ -92,15 +77,7 @@ void wake_thread(int thread_id) {
  * времени.
  **/
 void timer_tick() {
-  ++m_time;
-  if (m_time == m_timeslice) {
-    if (!thread_pool.empty()) {
-      thread_pool.push(current_thread_id);
-      current_thread_id = thread_pool.front();
-      thread_pool.pop();
-    }
-    m_time = 0;
-  }
+  scheduler.timer_tick();
 }
 
 /**
@@ -111,7 +88,7 @@ void timer_tick() {
  * либо уже завершены, либо заблокированы).
  **/
 int current_thread() {
-  return current_thread_id;
+  return scheduler.current_thread();
 }
 
 using namespace std;
@@ -1,36 +1,46 @@
-#include <atomic>
+#include "../../include/threads/rwm_locks.h"
 
 namespace RMWLock {
-  constexpr int LOCKED = 1;
-  constexpr int UNLOCKED = 0;
-
-  struct Mutex {
-    std::atomic<uint64_t> locked;
-  };
-
-  void lock(Mutex * lock) {
-    while (lock->locked.exchange(LOCKED) != UNLOCKED);
+  template <typename Layout, typename Order>
+  void lock(BasicMutex<Layout, Order> * lock) {
+    while (lock->locked.value.exchange(LOCKED, Order::ACQUIRE) != UNLOCKED);
   }
 
-  void unlock(Mutex * lock) {
-    lock->locked.store(UNLOCKED);
+  template <typename Layout, typename Order>
+  void unlock(BasicMutex<Layout, Order> * lock) {
+    lock->locked.value.store(UNLOCKED, Order::RELEASE);
   }
+
+  template void lock(BasicMutex<PackedLayout, SeqCstOrder> *);
+  template void lock(BasicMutex<PackedLayout, AcquireReleaseOrder> *);
+  template void lock(BasicMutex<PaddedLayout, SeqCstOrder> *);
+  template void lock(BasicMutex<PaddedLayout, AcquireReleaseOrder> *);
+  template void unlock(BasicMutex<PackedLayout, SeqCstOrder> *);
+  template void unlock(BasicMutex<PackedLayout, AcquireReleaseOrder> *);
+  template void unlock(BasicMutex<PaddedLayout, SeqCstOrder> *);
+  template void unlock(BasicMutex<PaddedLayout, AcquireReleaseOrder> *);
 }
 
 namespace TicketLock {
   // Non-explicit thread queue is implemented using tickets
 
-  struct Mutex {
-    std::atomic<uint64_t> next;
-    std::atomic<uint64_t> ticket;
-  };
-
-  void lock(Mutex * lock) {
-    auto ticket = lock->ticket.fetch_add(1);
-    while (lock->next.load() != ticket);
+  template <typename Layout, typename Order>
+  void lock(BasicMutex<Layout, Order> * lock) {
+    auto ticket = lock->ticket.value.fetch_add(1, Order::RELAXED);
+    while (lock->next.value.load(Order::ACQUIRE) != ticket);
   }
 
-  void unlock(Mutex * lock) {
-    lock->next.fetch_add(1);
+  template <typename Layout, typename Order>
+  void unlock(BasicMutex<Layout, Order> * lock) {
+    lock->next.value.fetch_add(1, Order::RELEASE);
   }
-}
\ No newline at end of file
+
+  template void lock(BasicMutex<PackedLayout, SeqCstOrder> *);
+  template void lock(BasicMutex<PackedLayout, AcquireReleaseOrder> *);
+  template void lock(BasicMutex<PaddedLayout, SeqCstOrder> *);
+  template void lock(BasicMutex<PaddedLayout, AcquireReleaseOrder> *);
+  template void unlock(BasicMutex<PackedLayout, SeqCstOrder> *);
+  template void unlock(BasicMutex<PackedLayout, AcquireReleaseOrder> *);
+  template void unlock(BasicMutex<PaddedLayout, SeqCstOrder> *);
+  template void unlock(BasicMutex<PaddedLayout, AcquireReleaseOrder> *);
+}
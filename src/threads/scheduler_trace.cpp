@@ -0,0 +1,133 @@
+#include <cstdio>
+
+#include "../../include/threads/scheduler_trace.h"
+
+constexpr uint32_t TraceEvent::THREAD_BITS;
+constexpr uint32_t TraceEvent::MAX_THREAD;
+
+namespace {
+  constexpr uint32_t MAX_DELTA = ~uint32_t(0);
+
+  void append_number(char const* format, double value, std::string& out) {
+    char buf[64];
+    int const len = snprintf(buf, sizeof(buf), format, value);
+    out.append(buf, static_cast<size_t>(len));
+  }
+
+  void append_number(char const* format, uint64_t value, std::string& out) {
+    char buf[64];
+    int const len = snprintf(buf, sizeof(buf), format, static_cast<unsigned long long>(value));
+    out.append(buf, static_cast<size_t>(len));
+  }
+
+  // As a JSON string body: quotes, backslashes and control characters escaped, other bytes as they are
+  void append_escaped(std::string const& text, std::string& out) {
+    for (char const c : text) {
+      if (c == '"' || c == '\\') {
+        out += '\\';
+        out += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+        out += buf;
+      } else {
+        out += c;
+      }
+    }
+  }
+}
+
+bool TraceWriter::open(char const* path) {
+  m_time = 0;
+  m_count = 0;
+  if (!m_out.open(path)) {
+    return false;
+  }
+  TraceHeader header {};
+  std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.header_size = sizeof(TraceHeader);
+  m_out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  return true;
+}
+
+bool TraceWriter::close() {
+  return m_out.close();
+}
+
+bool TraceWriter::add(TraceEventKind const kind, uint64_t const time, int const thread) {
+  if (time < m_time || thread < 0 || static_cast<uint32_t>(thread) > TraceEvent::MAX_THREAD) {
+    return false;
+  }
+  uint64_t delta = time - m_time;
+  for (; delta > MAX_DELTA; delta -= MAX_DELTA) {
+    TraceEvent const tick { MAX_DELTA, static_cast<uint32_t>(TraceEventKind::TICK) << TraceEvent::THREAD_BITS };
+    m_out.write(reinterpret_cast<char const*>(&tick), sizeof(tick));
+    ++m_count;
+  }
+  TraceEvent const event { static_cast<uint32_t>(delta),
+                           static_cast<uint32_t>(kind) << TraceEvent::THREAD_BITS | static_cast<uint32_t>(thread) };
+  m_out.write(reinterpret_cast<char const*>(&event), sizeof(event));
+  ++m_count;
+  m_time = time;
+  return true;
+}
+
+bool SchedulerTrace::fail(char const* error) {
+  m_error = error;
+  m_events = nullptr;
+  m_count = 0;
+  m_file.close();
+  return false;
+}
+
+bool SchedulerTrace::open(char const* path) {
+  m_error = "";
+  if (!m_file.open(path)) {
+    return fail("can't open the file");
+  }
+  TraceHeader header;
+  if (m_file.size() < sizeof(header)) {
+    return fail("the file is shorter than the header");
+  }
+  std::memcpy(&header, m_file.data(), sizeof(header));
+  if (std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) {
+    return fail("not a scheduler trace");
+  }
+  if (header.version != TRACE_VERSION) {
+    return fail("unsupported trace version");
+  }
+  if (header.header_size < sizeof(header) || header.header_size > m_file.size() ||
+      header.header_size % alignof(TraceEvent) != 0) {
+    return fail("bad header size");
+  }
+  size_t const records = m_file.size() - header.header_size;
+  if (records % sizeof(TraceEvent) != 0) {
+    return fail("the last record is cut off");
+  }
+  m_events = reinterpret_cast<TraceEvent const*>(m_file.data() + header.header_size);
+  m_count = records / sizeof(TraceEvent);
+  return true;
+}
+
+void format_replay_summary(ReplaySummary const& summary, std::string& out) {
+  out += "{\"policy\":\"";
+  append_escaped(summary.policy, out);
+  append_number("\",\"events\":%llu", summary.events, out);
+  append_number(",\"ticks\":%llu", summary.ticks, out);
+  append_number(",\"threads\":%llu", summary.threads, out);
+  append_number(",\"finished\":%llu", summary.finished, out);
+  append_number(",\"context_switches\":%llu", summary.context_switches, out);
+  append_number(",\"idle_ticks\":%llu", summary.idle_ticks, out);
+  append_number(",\"deferred\":%llu", summary.deferred, out);
+  append_number(",\"cancelled\":%llu", summary.cancelled, out);
+  append_number(",\"ignored\":%llu", summary.ignored, out);
+  append_number(",\"invalid\":%llu", summary.invalid, out);
+  append_number(",\"avg_turnaround\":%.3f", summary.avg_turnaround, out);
+  append_number(",\"avg_wait\":%.3f", summary.avg_wait, out);
+  append_number(",\"avg_response\":%.3f", summary.avg_response, out);
+  append_number(",\"max_response\":%llu", summary.max_response, out);
+  append_number(",\"seconds\":%.3f", summary.seconds, out);
+  append_number(",\"events_per_second\":%.0f", summary.seconds > 0 ? summary.events / summary.seconds : 0.0, out);
+  out += "}\n";
+}
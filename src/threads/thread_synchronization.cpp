@@ -1,14 +1,13 @@
-#include <atomic>
 #include <cstdio>
 #include <thread>
-#include <array>
+
+#include "../../include/threads/thread_synchronization.h"
+
 // Atomic RW register
 //  'read' - atomically reads from the RW register
 //  'write' - atomically writes to the RW register
 //  'read' and 'write' operations are ordered!!!
 
-typedef uint64_t ThID;
-
 #ifdef _WINDOWS
   #include <windows.h>
 
@@ -49,10 +48,6 @@ namespace Alternation {
 //      2) So, after th_0 go to the infinite cycle in the first lock attempt:
 //         threadId() == 0 and so (&lock->victim == 0) is always true!
 
-  struct Mutex {
-    std::atomic<ThID> victim;
-  };
-
   void lock_init(Mutex *lock) {
     lock->victim.store(0ULL);
   }
@@ -76,10 +71,6 @@ namespace IntentionFlags {
 //      2) They will hang forever in the lock cycle
 //            while (lock->flag[other].load()));
 
-  struct Mutex {
-    std::array<std::atomic<ThID>, 2> flag;
-  };
-
   void lock_init(Mutex *lock) {
     lock->flag[0].store(0ULL);
     lock->flag[1].store(0ULL);
@@ -105,33 +96,46 @@ namespace Peterson2Threads {
 // + Has mutual exclusion - true
 // + Has thread liveness - true
 
-  struct Mutex {
-    std::atomic<ThID> victim;
-    std::array<std::atomic<ThID>, 2> flag;
-  };
-
   void lock_init(Mutex *lock) {
-    lock->victim.store(0ULL);
-    lock->flag[0].store(0ULL);
-    lock->flag[1].store( 0ULL);
+    lock->victim.value.store(0ULL);
+    lock->flag[0].value.store(0ULL);
+    lock->flag[1].value.store( 0ULL);
   }
 
-  void lock(struct Mutex *lock) {
-    const ThID me = threadId();
-    const ThID other = 1 - threadId();
+  void lock(Mutex *lock) {
+    Peterson2Threads::lock(lock, threadId());
+  }
+
+  // The flag and victim stores have to be visible before the loads, that takes seq_cst under any Order
+  template <typename Layout, typename Order>
+  void lock(BasicMutex<Layout, Order> *lock, ThID me) {
+    const ThID other = 1 - me;
 
     // The order is important!
-    lock->flag[me].store( 1ULL);
-    lock->victim.store(me);
+    lock->flag[me].value.store( 1ULL);
+    lock->victim.value.store(me);
 
-    while (lock->flag[other].load() && (lock->victim.load() == me));
+    while (lock->flag[other].value.load() && (lock->victim.value.load() == me));
   }
 
-  void unlock(struct Mutex *lock) {
-    const ThID me = threadId();
-    lock->flag[me].store(0ULL);
+  void unlock(Mutex *lock) {
+    unlock(lock, threadId());
   }
 
+  template <typename Layout, typename Order>
+  void unlock(BasicMutex<Layout, Order> *lock, ThID me) {
+    lock->flag[me].value.store(0ULL, Order::RELEASE);
+  }
+
+  template void lock(BasicMutex<PackedLayout, SeqCstOrder> *, ThID);
+  template void lock(BasicMutex<PackedLayout, AcquireReleaseOrder> *, ThID);
+  template void lock(BasicMutex<PaddedLayout, SeqCstOrder> *, ThID);
+  template void lock(BasicMutex<PaddedLayout, AcquireReleaseOrder> *, ThID);
+  template void unlock(BasicMutex<PackedLayout, SeqCstOrder> *, ThID);
+  template void unlock(BasicMutex<PackedLayout, AcquireReleaseOrder> *, ThID);
+  template void unlock(BasicMutex<PaddedLayout, SeqCstOrder> *, ThID);
+  template void unlock(BasicMutex<PaddedLayout, AcquireReleaseOrder> *, ThID);
+
   //  Wrong order of instructions
   //    1.lock->victim, me);
   //    2. lock->flag[me], 1);
@@ -158,20 +162,15 @@ namespace PetersonGreedy {
 // -------------------------------------------------------------------------------------------------
 // level 0, N threads                 :     |0 ? 1|     |1 ? 2| ..... |i ? j| .... |n - 1 ? n|
 
-  constexpr int N = 10;
-
 // Default implementation with O(N^2) atomics
 
 // Step 1. Introduce new struct LockOne with N flags.
 // LockOne is used in lock_one function to start a competition between many threads
-  struct LockOne {
-    std::atomic<ThID> victim;
-    std::array<std::atomic<ThID>, N> flags;
-  };
-
   bool flags_clear(LockOne *lock) {
-    const ThID me = threadId();
+    return flags_clear(lock, threadId());
+  }
 
+  bool flags_clear(LockOne *lock, ThID me) {
     for (int i = 0; i < N; ++i) {
       if (i != me && lock->flags[i].load()) {
         return false;
@@ -184,36 +183,45 @@ namespace PetersonGreedy {
 // "Filter function" guarantees mutual exclusion.
 // If N threads call lock_one then N - 1 pass, and a single thread remains to wait for
   void lock_one(LockOne *lock) {
-    const ThID me = threadId();
+    lock_one(lock, threadId());
+  }
 
+  void lock_one(LockOne *lock, ThID me) {
     lock->flags[me].store(1);
     lock->victim.store(me);
 
-    while (!flags_clear(lock) && (lock->victim.load() == me));
+    while (!flags_clear(lock, me) && (lock->victim.load() == me));
   }
 
   void unlock_one(LockOne *lock) {
-    const ThID me = threadId();
+    unlock_one(lock, threadId());
+  }
 
+  void unlock_one(LockOne *lock, ThID me) {
     lock->flags[me].store(0);
   }
 
-  // Peterson algorithm with O(N^2) memory
-  struct Mutex {
-    std::array<LockOne, N -1> locks;
-  };
+  // Peterson algorithm with O(N^2) memory: Mutex::locks, one LockOne per level
 
   void lock(Mutex *mutex) {
+    lock(mutex, threadId());
+  }
+
+  void lock(Mutex *mutex, ThID me) {
     // N - 1 times we have to win to pass to the critical section while other threads loose and are waiting for the lock
     for (int level = 0; level < N - 1; ++level) {
-      lock_one(&mutex->locks[level]);
+      lock_one(&mutex->locks[level], me);
     }
   }
 
   void unlock(Mutex *mutex) {
+    unlock(mutex, threadId());
+  }
+
+  void unlock(Mutex *mutex, ThID me) {
     // We have to unlock flags for all threads [0, N - 2]
     for (int level = 0; level < N - 1; ++level) {
-      unlock_one(&mutex->locks[level]);
+      unlock_one(&mutex->locks[level], me);
     }
   }
 }
@@ -229,16 +237,13 @@ namespace PetersonGreedy {
 // We can optimize it using only O(N) atomic registers to sync N threads
 
 namespace OptimizedPeterson {
-  constexpr int N = 10;
-
-  struct Mutex {
-    std::array<std::atomic<ThID>, N> level; // the length of the 1's prefix|postfix (1111 ... 000 or 000....11111)
-    std::array<std::atomic<ThID>, N - 1> victim;
-  };
+  // Mutex::level[i] is the length of the 1's prefix of thread i, Mutex::victim one per level
 
-  bool flags_clear(Mutex* lock, ThID me, int level) {
+  // The level and victim stores have to be visible before the loads, that takes seq_cst under any Order
+  template <typename Layout, typename Order>
+  bool flags_clear(BasicMutex<Layout, Order>* lock, ThID me, int level) {
     for (int i = 0; i < N; ++i) {
-      if (i != me && (lock->level[i].load() == level)) {
+      if (i != me && (lock->level[i].value.load() > static_cast<ThID>(level))) {
         return false;
       }
     }
@@ -247,20 +252,40 @@ namespace OptimizedPeterson {
   }
 
   void lock(Mutex* lock) {
-    const ThID me = threadId();
+    OptimizedPeterson::lock(lock, threadId());
+  }
 
+  template <typename Layout, typename Order>
+  void lock(BasicMutex<Layout, Order>* lock, ThID me) {
     for (int level = 0; level < N - 1; ++level) {
-      lock->level[me].store(level + 1);
-      lock->victim[level].store(me);
+      lock->level[me].value.store(level + 1);
+      lock->victim[level].value.store(me);
 
       // To pass to the next level we compete with all other threads
       // (exist i: i != me) and (level[i] >= level) and victim[level] == me
-      while (!flags_clear(lock, me, level) && (lock->victim[level].load() == me));
+      while (!flags_clear(lock, me, level) && (lock->victim[level].value.load() == me));
     }
   }
 
   void unlock(Mutex* lock) {
-    const ThID me = threadId();
-    lock->level[me].store(0ULL);
+    unlock(lock, threadId());
+  }
+
+  template <typename Layout, typename Order>
+  void unlock(BasicMutex<Layout, Order>* lock, ThID me) {
+    lock->level[me].value.store(0ULL, Order::RELEASE);
   }
-}
\ No newline at end of file
+
+  template bool flags_clear(BasicMutex<PackedLayout, SeqCstOrder>*, ThID, int);
+  template bool flags_clear(BasicMutex<PackedLayout, AcquireReleaseOrder>*, ThID, int);
+  template bool flags_clear(BasicMutex<PaddedLayout, SeqCstOrder>*, ThID, int);
+  template bool flags_clear(BasicMutex<PaddedLayout, AcquireReleaseOrder>*, ThID, int);
+  template void lock(BasicMutex<PackedLayout, SeqCstOrder>*, ThID);
+  template void lock(BasicMutex<PackedLayout, AcquireReleaseOrder>*, ThID);
+  template void lock(BasicMutex<PaddedLayout, SeqCstOrder>*, ThID);
+  template void lock(BasicMutex<PaddedLayout, AcquireReleaseOrder>*, ThID);
+  template void unlock(BasicMutex<PackedLayout, SeqCstOrder>*, ThID);
+  template void unlock(BasicMutex<PackedLayout, AcquireReleaseOrder>*, ThID);
+  template void unlock(BasicMutex<PaddedLayout, SeqCstOrder>*, ThID);
+  template void unlock(BasicMutex<PaddedLayout, AcquireReleaseOrder>*, ThID);
+}
@@ -0,0 +1,184 @@
+#include "../include/tlb.h"
+
+namespace {
+  // Logical address bits that select the entry kept in the PLM4, DirectoryPtr and Directory caches
+  constexpr AddressPart const PAGING_STRUCTURE_KEYS[] = { { mask(39, 47), 39 }, { mask(30, 47), 30 }, { mask(21, 47), 21 } };
+}
+
+SetAssociativeCache::SetAssociativeCache(size_t const entries, size_t const ways, Replacement const replacement) {
+  if (entries == 0) {
+    return;
+  }
+  m_ways = (ways == 0 || ways > entries) ? entries : ways;
+  // Round the number of sets down to a power of two, so a set is selected by the low bits of the key
+  m_sets = 1;
+  while (m_sets * 2 * m_ways <= entries) {
+    m_sets *= 2;
+  }
+  m_lines.assign(m_sets * m_ways, Line { 0, 0, 0 });
+  m_pseudo_lru = replacement == Replacement::PSEUDO_LRU && m_ways <= 64 && (m_ways & (m_ways - 1)) == 0;
+  if (m_pseudo_lru) {
+    m_plru.assign(m_sets, 0);
+  }
+}
+
+bool SetAssociativeCache::lookup(uint64_t const key, uint64_t& value) {
+  if (m_sets == 0) {
+    return false;
+  }
+  size_t const set = key & (m_sets - 1);
+  Line* lines = &m_lines[set * m_ways];
+  for (size_t way = 0; way < m_ways; ++way) {
+    if (lines[way].last_use && lines[way].key == key) {
+      value = lines[way].value;
+      touch(set, way);
+      return true;
+    }
+  }
+  return false;
+}
+
+void SetAssociativeCache::insert(uint64_t const key, uint64_t const value) {
+  if (m_sets == 0) {
+    return;
+  }
+  size_t const set = key & (m_sets - 1);
+  size_t const way = victim(set);
+  m_lines[set * m_ways + way] = Line { key, value, 0 };
+  touch(set, way);
+}
+
+void SetAssociativeCache::clear() {
+  for (auto& line : m_lines) {
+    line.last_use = 0;
+  }
+  for (auto& bits : m_plru) {
+    bits = 0;
+  }
+}
+
+void SetAssociativeCache::touch(size_t const set, size_t const way) {
+  m_lines[set * m_ways + way].last_use = ++m_clock;
+  if (!m_pseudo_lru) {
+    return;
+  }
+  // Every node on the path points away from the used way
+  uint64_t& bits = m_plru[set];
+  size_t node = 0;
+  for (size_t half = m_ways / 2; half >= 1; half /= 2) {
+    size_t const right = (way & half) ? 1 : 0;
+    if (right) {
+      bits &= ~(1ULL << node);
+    } else {
+      bits |= 1ULL << node;
+    }
+    node = 2 * node + 1 + right;
+  }
+}
+
+size_t SetAssociativeCache::victim(size_t const set) const {
+  Line const* lines = &m_lines[set * m_ways];
+  for (size_t way = 0; way < m_ways; ++way) {
+    if (!lines[way].last_use) {
+      return way;
+    }
+  }
+
+  size_t res = 0;
+  if (m_pseudo_lru) {
+    uint64_t const bits = m_plru[set];
+    size_t node = 0;
+    for (size_t half = m_ways / 2; half >= 1; half /= 2) {
+      size_t const right = (bits >> node) & 1;
+      res += right * half;
+      node = 2 * node + 1 + right;
+    }
+  } else {
+    for (size_t way = 1; way < m_ways; ++way) {
+      if (lines[way].last_use < lines[res].last_use) {
+        res = way;
+      }
+    }
+  }
+  return res;
+}
+
+TranslationCache::TranslationCache(PhysicalMemory const& memory, uint64_t const root_address, TlbConfig const& config) :
+    m_memory(memory),
+    m_root_address(root_address),
+    m_l1(config.l1_entries, config.l1_ways, config.replacement),
+    m_l2(config.l2_entries, config.l2_ways, config.replacement),
+    m_pml4(config.pml4_entries, 0, config.replacement),
+    m_pdpt(config.pdpt_entries, 0, config.replacement),
+    m_pd(config.pd_entries, 0, config.replacement) {}
+
+uint64_t TranslationCache::translate(uint64_t const logical_addr) {
+  ++m_stats.translations;
+  uint64_t const page = part_of_logical_address(logical_addr, VIRTUAL_PAGE_MASK);
+
+  uint64_t entry = 0;
+  if (m_l1.lookup(page, entry)) {
+    ++m_stats.l1_hits;
+  } else if (m_l2.lookup(page, entry)) {
+    ++m_stats.l2_hits;
+    m_l1.insert(page, entry);
+  } else {
+    ++m_stats.walks;
+
+    uint64_t const keys[] = { part_of_logical_address(logical_addr, PAGING_STRUCTURE_KEYS[0]),
+                              part_of_logical_address(logical_addr, PAGING_STRUCTURE_KEYS[1]),
+                              part_of_logical_address(logical_addr, PAGING_STRUCTURE_KEYS[2]) };
+    SetAssociativeCache* const caches[] = { &m_pml4, &m_pdpt, &m_pd };
+    uint64_t* const hits[] = { &m_stats.pml4_hits, &m_stats.pdpt_hits, &m_stats.pd_hits };
+
+    // Start from the lowest level whose upper entry is cached
+    size_t level = 0;
+    entry = m_root_address;
+    for (size_t i = 3; i > 0; --i) {
+      if (caches[i - 1]->lookup(keys[i - 1], entry)) {
+        ++*hits[i - 1];
+        level = i;
+        break;
+      }
+    }
+
+    for (; level < 4; ++level) {
+      ++m_stats.levels_touched;
+      entry = read_entry(entry, logical_addr, PAGE_LEVELS[level], m_memory);
+      if (!entry) {
+        ++m_stats.faults;
+        return TRANSLATION_FAULT;
+      }
+      if (level < 3) {
+        caches[level]->insert(keys[level], entry);
+      }
+    }
+    m_l2.insert(page, entry);
+    m_l1.insert(page, entry);
+  }
+
+  return part_of_logical_address(entry, PHYSICAL_ADDRESS_MASK) + part_of_logical_address(logical_addr, OFFSET_MASK);
+}
+
+void TranslationCache::flush() {
+  m_l1.clear();
+  m_l2.clear();
+  m_pml4.clear();
+  m_pdpt.clear();
+  m_pd.clear();
+}
+
+void print_tlb_stats(TlbStats const& stats, FILE* out) {
+  double const n = stats.translations ? static_cast<double>(stats.translations) : 1.0;
+  double const walks = stats.walks ? static_cast<double>(stats.walks) : 1.0;
+  fprintf(out, "translations: %llu, faults: %llu\n",
+          (unsigned long long) stats.translations, (unsigned long long) stats.faults);
+  fprintf(out, "L1 TLB hit rate: %.2f%%, L2 TLB hit rate: %.2f%% (of L1 misses)\n",
+          100.0 * stats.l1_hits / n,
+          stats.translations > stats.l1_hits ? 100.0 * stats.l2_hits / (stats.translations - stats.l1_hits) : 0.0);
+  fprintf(out, "walks: %llu (%.2f%% of translations), PD/PDPT/PLM4 cache hits per walk: %.2f%% / %.2f%% / %.2f%%\n",
+          (unsigned long long) stats.walks, 100.0 * stats.walks / n,
+          100.0 * stats.pd_hits / walks, 100.0 * stats.pdpt_hits / walks, 100.0 * stats.pml4_hits / walks);
+  fprintf(out, "levels touched: %.3f per translation, %.3f per walk\n",
+          stats.levels_touched / n, stats.levels_touched / walks);
+}
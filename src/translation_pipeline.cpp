@@ -0,0 +1,141 @@
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/batch_translation.h"
+#include "../include/translation_pipeline.h"
+
+namespace {
+  struct Chunk {
+    size_t seq = 0;
+    size_t count = 0;
+    std::vector<uint64_t> logical;
+    std::vector<uint64_t> physical;
+    std::string text;
+  };
+
+  struct PipelineState {
+    std::mutex mutex;
+    std::condition_variable work_ready;   // a chunk was parsed or the input ended
+    std::condition_variable chunk_done;   // a chunk was translated
+    std::condition_variable slot_free;    // a chunk was written
+
+    std::deque<std::unique_ptr<Chunk>> work;
+    std::vector<std::unique_ptr<Chunk>> done;  // translated chunks, slot = seq % max_in_flight
+    std::vector<std::unique_ptr<Chunk>> free;  // written chunks ready to be reused
+    size_t in_flight = 0;
+    size_t parsed = 0;                          // chunks handed to the workers so far
+    bool input_done = false;
+  };
+}
+
+size_t run_translation_pipeline(PhysicalMemory const& memory, uint64_t const root_address,
+                                QuerySource const& source, OutputSink const& sink,
+                                PipelineOptions const& options)
+{
+  size_t workers = options.workers ? options.workers : std::thread::hardware_concurrency();
+  workers = workers ? workers : 1;
+  size_t const chunk_size = options.chunk_size ? options.chunk_size : 1;
+  size_t const max_in_flight = options.max_in_flight ? options.max_in_flight : 4 * workers;
+
+  PipelineState state;
+  state.done.resize(max_in_flight);
+
+  std::vector<std::thread> pool;
+  for (size_t i = 0; i < workers; ++i) {
+    pool.emplace_back([&]() {
+      for (;;) {
+        std::unique_ptr<Chunk> chunk;
+        {
+          std::unique_lock<std::mutex> lock(state.mutex);
+          state.work_ready.wait(lock, [&]() { return !state.work.empty() || state.input_done; });
+          if (state.work.empty()) {
+            return;
+          }
+          chunk = std::move(state.work.front());
+          state.work.pop_front();
+        }
+
+        chunk->physical.resize(chunk->count);
+        translate_batch(memory, root_address, chunk->logical.data(), chunk->count, chunk->physical.data());
+        chunk->text.clear();
+        format_translations(chunk->physical.data(), chunk->count, chunk->text);
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        size_t const slot = chunk->seq % max_in_flight;
+        state.done[slot] = std::move(chunk);
+        state.chunk_done.notify_all();
+      }
+    });
+  }
+
+  size_t translated = 0;
+  std::thread writer([&]() {
+    for (size_t next = 0;; ++next) {
+      std::unique_ptr<Chunk> chunk;
+      {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        size_t const slot = next % max_in_flight;
+        state.chunk_done.wait(lock, [&]() {
+          return state.done[slot] || (state.input_done && next == state.parsed);
+        });
+        if (!state.done[slot]) {
+          return;
+        }
+        chunk = std::move(state.done[slot]);
+      }
+
+      sink(chunk->text.data(), chunk->text.size());
+      translated += chunk->count;
+
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.free.push_back(std::move(chunk));
+      --state.in_flight;
+      state.slot_free.notify_one();
+    }
+  });
+
+  for (size_t seq = 0;; ++seq) {
+    std::unique_ptr<Chunk> chunk;
+    {
+      std::unique_lock<std::mutex> lock(state.mutex);
+      state.slot_free.wait(lock, [&]() { return state.in_flight < max_in_flight; });
+      if (!state.free.empty()) {
+        chunk = std::move(state.free.back());
+        state.free.pop_back();
+      }
+    }
+    if (!chunk) {
+      chunk.reset(new Chunk());
+      chunk->logical.resize(chunk_size);
+    }
+
+    chunk->seq = seq;
+    chunk->count = source(chunk->logical.data(), chunk_size);
+    if (chunk->count == 0) {
+      break;
+    }
+
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.work.push_back(std::move(chunk));
+    ++state.in_flight;
+    ++state.parsed;
+    state.work_ready.notify_one();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.input_done = true;
+    state.work_ready.notify_all();
+    state.chunk_done.notify_all();
+  }
+  for (auto& thread : pool) {
+    thread.join();
+  }
+  writer.join();
+  return translated;
+}